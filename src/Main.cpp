@@ -14,13 +14,30 @@
 #include <fstream>
 #include <array>
 #include <queue>
+#include <deque>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
 
 #include <chrono>
 #include <functional>
+#include <memory>
+#include <sstream>
+#include <tuple>
+#include <filesystem>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../include/stbi/stb_image.h"
@@ -28,12 +45,37 @@
 #include <assimp/Importer.hpp>      
 #include <assimp/scene.h>           
 #include <assimp/postprocess.h>
+#include <assimp/fast_atof.h>
 
 #define VMA_IMPLEMENTATION
 #include <vk_mem_alloc.h>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+const VkDeviceSize MEMORY_BLOCK_SIZE = 64ull * 1024 * 1024;
+const VkDeviceSize DEDICATED_ALLOCATION_THRESHOLD = 8ull * 1024 * 1024;
+const VkDeviceSize STAGING_RING_SIZE = 64ull * 1024 * 1024;
+const VkDeviceSize UPLOAD_BATCH_SIZE = 16ull * 1024 * 1024;
+
+//Steps every import runs, the ones producing vertex attributes are added per file from the import profile
+const unsigned int MODEL_IMPORT_BASE_FLAGS = aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_PreTransformVertices;
+//Bump whenever the cooked layout or anything written into it changes, old caches then get rebuilt
+const uint32_t COOKED_MODEL_VERSION = 8;
+const uint32_t COOKED_MODEL_MAGIC = 0x4C444D43;
+//Same for textures cooked into block compressed KTX2 files, it is hashed together with the source image
+const uint32_t COOKED_TEXTURE_VERSION = 2;
+
 #ifdef NDEBUG
 const bool EnableValidationLayers = false;
 #else 
@@ -78,9 +120,31 @@ std::vector<char> ReadFile(const char* FileName)
     return Buffer;
 }
 
+//FNV-1a style hash that consumes 8 bytes per step, only used to detect changed inputs
+uint64_t HashBytes(const void* Data, size_t Size, uint64_t Hash = 14695981039346656037ull)
+{
+    const uint64_t Prime = 1099511628211ull;
+    const char* Bytes = static_cast<const char*>(Data);
+
+    size_t WordCount = Size / sizeof(uint64_t);
+    for (size_t i = 0; i < WordCount; i++)
+    {
+        uint64_t Word;
+        memcpy(&Word, Bytes + i * sizeof(uint64_t), sizeof(uint64_t));
+        Hash = (Hash ^ Word) * Prime;
+        Hash ^= Hash >> 29;
+    }
+    for (size_t i = WordCount * sizeof(uint64_t); i < Size; i++)
+    {
+        Hash = (Hash ^ static_cast<unsigned char>(Bytes[i])) * Prime;
+    }
+    return Hash;
+}
+
 struct QueueFamilyIndices {
     std::optional<uint32_t> GraphicsFamily;
     std::optional<uint32_t> PresentFamily;
+    std::optional<uint32_t> TransferFamily;
 
     bool isComplete() {
         return GraphicsFamily.has_value() && PresentFamily.has_value();
@@ -93,6 +157,290 @@ struct SwapChainSupportDetails {
     std::vector<VkPresentModeKHR> PresentModes;
 };
 
+//Value of the upload timeline semaphore that is signaled once a batch of copies has finished on the GPU
+typedef uint64_t UploadTicket;
+
+struct StagingRegion
+{
+    VkDeviceSize End;
+    VkDeviceSize Bytes;
+    UploadTicket Ticket;
+};
+
+//One persistently mapped host visible buffer that every upload writes into.
+//Space is handed out linearly and wraps around, regions are given back once the submission reading them has completed.
+struct StagingRingBuffer
+{
+    VkBuffer Buffer = VK_NULL_HANDLE;
+    VmaAllocation Allocation = VK_NULL_HANDLE;
+    char* MappedData = nullptr;
+    VkDeviceSize Capacity = 0;
+
+    VkDeviceSize Head = 0;
+    VkDeviceSize Tail = 0;
+    VkDeviceSize AllocatedBytes = 0;
+    VkDeviceSize PendingBytes = 0;
+    std::deque<StagingRegion> InFlightRegions;
+
+    bool TryAllocate(VkDeviceSize Size, VkDeviceSize Alignment, VkDeviceSize& Offset)
+    {
+        if (AllocatedBytes == 0)
+        {
+            Head = Tail = 0;
+        }
+
+        VkDeviceSize Start = (Head + Alignment - 1) & ~(Alignment - 1);
+        bool IsWrapped = Head < Tail || (Head == Tail && AllocatedBytes > 0);
+
+        if (IsWrapped)
+        {
+            if (Start + Size > Tail) return false;
+        }
+        else if (Start + Size > Capacity)
+        {
+            //Skip the leftover space at the end and continue from the beginning
+            if (Size > Tail) return false;
+            Start = 0;
+            AllocatedBytes += Capacity - Head;
+            PendingBytes += Capacity - Head;
+            Head = 0;
+        }
+
+        AllocatedBytes += Start + Size - Head;
+        PendingBytes += Start + Size - Head;
+        Head = Start + Size;
+        Offset = Start;
+        return true;
+    }
+
+    //Everything allocated since the previous call is owned by the submission that signals the ticket
+    void Submit(UploadTicket Ticket)
+    {
+        if (PendingBytes == 0) return;
+        InFlightRegions.push_back({ Head, PendingBytes, Ticket });
+        PendingBytes = 0;
+    }
+
+    void Reclaim(UploadTicket CompletedTicket)
+    {
+        while (!InFlightRegions.empty() && InFlightRegions.front().Ticket <= CompletedTicket)
+        {
+            auto& Region = InFlightRegions.front();
+            AllocatedBytes -= Region.Bytes;
+            Tail = Region.End;
+            InFlightRegions.pop_front();
+        }
+    }
+};
+
+struct UploadBatch
+{
+    VkCommandBuffer CommandBuffer;
+    UploadTicket Ticket;
+};
+
+//Records copies into batches that are submitted on the transfer queue, or on the graphics queue when there isn't a dedicated one.
+//Each batch signals the next value of a timeline semaphore, so the renderer can poll or wait on it instead of idling the queue.
+struct UploadEngine
+{
+    VkDevice Device = VK_NULL_HANDLE;
+    VkQueue Queue = VK_NULL_HANDLE;
+    uint32_t QueueFamily = 0;
+    VkCommandPool CommandPool = VK_NULL_HANDLE;
+    VkSemaphore Timeline = VK_NULL_HANDLE;
+    StagingRingBuffer StagingRing;
+
+    UploadTicket NextTicket = 1;
+    VkCommandBuffer RecordingCommandBuffer = VK_NULL_HANDLE;
+    VkDeviceSize RecordedBytes = 0;
+    std::deque<UploadBatch> InFlightBatches;
+    std::vector<VkCommandBuffer> FreeCommandBuffers;
+
+    void Create(VkDevice LogicalDevice, VkQueue TransferQueue, uint32_t TransferQueueFamily)
+    {
+        Device = LogicalDevice;
+        Queue = TransferQueue;
+        QueueFamily = TransferQueueFamily;
+
+        VkCommandPoolCreateInfo CommandPoolCreateInfo{};
+        CommandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        CommandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        CommandPoolCreateInfo.queueFamilyIndex = QueueFamily;
+
+        if (vkCreateCommandPool(Device, &CommandPoolCreateInfo, nullptr, &CommandPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the upload command pool!");
+        }
+
+        VkSemaphoreTypeCreateInfo SemaphoreTypeCreateInfo{};
+        SemaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        SemaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        SemaphoreTypeCreateInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo SemaphoreCreateInfo{};
+        SemaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        SemaphoreCreateInfo.pNext = &SemaphoreTypeCreateInfo;
+
+        if (vkCreateSemaphore(Device, &SemaphoreCreateInfo, nullptr, &Timeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the upload timeline semaphore!");
+        }
+    }
+
+    void Destroy()
+    {
+        Wait(NextTicket - 1);
+        vkDestroySemaphore(Device, Timeline, nullptr);
+        vkDestroyCommandPool(Device, CommandPool, nullptr);
+    }
+
+    //Ticket of the batch that is currently being recorded, it completes only after the batch gets flushed
+    UploadTicket GetPendingTicket() const
+    {
+        return NextTicket;
+    }
+
+    UploadTicket GetCompletedTicket()
+    {
+        uint64_t Value = 0;
+        vkGetSemaphoreCounterValue(Device, Timeline, &Value);
+        return Value;
+    }
+
+    bool IsComplete(UploadTicket Ticket)
+    {
+        return Ticket <= GetCompletedTicket();
+    }
+
+    void Wait(UploadTicket Ticket)
+    {
+        if (Ticket >= NextTicket)
+        {
+            Flush();
+            if (Ticket >= NextTicket) return;
+        }
+
+        VkSemaphoreWaitInfo WaitInfo{};
+        WaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        WaitInfo.semaphoreCount = 1;
+        WaitInfo.pSemaphores = &Timeline;
+        WaitInfo.pValues = &Ticket;
+        vkWaitSemaphores(Device, &WaitInfo, UINT64_MAX);
+        Retire();
+    }
+
+    void Retire()
+    {
+        UploadTicket CompletedTicket = GetCompletedTicket();
+        StagingRing.Reclaim(CompletedTicket);
+        while (!InFlightBatches.empty() && InFlightBatches.front().Ticket <= CompletedTicket)
+        {
+            FreeCommandBuffers.push_back(InFlightBatches.front().CommandBuffer);
+            InFlightBatches.pop_front();
+        }
+    }
+
+    //May flush the batch being recorded to make room, so call it before GetCommandBuffer
+    VkDeviceSize AllocateStaging(VkDeviceSize Size, VkDeviceSize Alignment)
+    {
+        if (Size > StagingRing.Capacity)
+        {
+            throw std::runtime_error("Staging allocation is bigger than the staging ring!");
+        }
+
+        VkDeviceSize Offset;
+        Retire();
+        while (!StagingRing.TryAllocate(Size, Alignment, Offset))
+        {
+            //The space we are waiting for might belong to the batch being recorded
+            if (StagingRing.InFlightRegions.empty())
+            {
+                GetCommandBuffer();
+                Flush();
+            }
+            Wait(StagingRing.InFlightRegions.front().Ticket);
+        }
+        RecordedBytes += Size;
+        return Offset;
+    }
+
+    VkCommandBuffer GetCommandBuffer()
+    {
+        if (RecordingCommandBuffer != VK_NULL_HANDLE) return RecordingCommandBuffer;
+
+        Retire();
+        if (!FreeCommandBuffers.empty())
+        {
+            RecordingCommandBuffer = FreeCommandBuffers.back();
+            FreeCommandBuffers.pop_back();
+        }
+        else
+        {
+            VkCommandBufferAllocateInfo CommandBufferAllocateInfo{};
+            CommandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            CommandBufferAllocateInfo.commandPool = CommandPool;
+            CommandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            CommandBufferAllocateInfo.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(Device, &CommandBufferAllocateInfo, &RecordingCommandBuffer) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to allocate an upload command buffer!");
+            }
+        }
+
+        VkCommandBufferBeginInfo CommandBufferBeginInfo{};
+        CommandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        CommandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(RecordingCommandBuffer, &CommandBufferBeginInfo);
+
+        return RecordingCommandBuffer;
+    }
+
+    UploadTicket FlushIfFull()
+    {
+        UploadTicket Ticket = GetPendingTicket();
+        if (RecordedBytes >= UPLOAD_BATCH_SIZE)
+        {
+            Flush();
+        }
+        return Ticket;
+    }
+
+    //Submits the recorded copies and returns the ticket of the last submitted batch
+    UploadTicket Flush()
+    {
+        if (RecordingCommandBuffer == VK_NULL_HANDLE) return NextTicket - 1;
+
+        vkEndCommandBuffer(RecordingCommandBuffer);
+
+        UploadTicket Ticket = NextTicket++;
+
+        VkTimelineSemaphoreSubmitInfo TimelineSubmitInfo{};
+        TimelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        TimelineSubmitInfo.signalSemaphoreValueCount = 1;
+        TimelineSubmitInfo.pSignalSemaphoreValues = &Ticket;
+
+        VkSubmitInfo SubmitInfo{};
+        SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        SubmitInfo.pNext = &TimelineSubmitInfo;
+        SubmitInfo.commandBufferCount = 1;
+        SubmitInfo.pCommandBuffers = &RecordingCommandBuffer;
+        SubmitInfo.signalSemaphoreCount = 1;
+        SubmitInfo.pSignalSemaphores = &Timeline;
+
+        if (vkQueueSubmit(Queue, 1, &SubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit upload commands!");
+        }
+
+        StagingRing.Submit(Ticket);
+        InFlightBatches.push_back({ RecordingCommandBuffer, Ticket });
+        RecordingCommandBuffer = VK_NULL_HANDLE;
+        RecordedBytes = 0;
+        return Ticket;
+    }
+};
+
 struct Vertex2D {
     glm::vec2 Position;
     glm::vec3 Color;
@@ -130,145 +478,4384 @@ struct Vertex2D {
     }
 };
 
+//Vertices are uploaded as two streams, positions on their own and the rest of the attributes interleaved after them,
+//so passes that only need depth fetch nothing but positions. Stream 0 and location 0 is always the position.
+const uint32_t VERTEX_STREAM_COUNT = 2;
+const uint32_t VERTEX_STREAM_POSITION = 0;
+const uint32_t VERTEX_STREAM_ATTRIBUTES = 1;
+
+//Everything of a Vertex3D but its position, as it is laid out in the attribute stream
+struct Vertex3DAttributes {
+    glm::vec3 Color;
+    glm::vec2 UV;
+    glm::vec3 Normal;
+};
+
 struct Vertex3D {
     glm::vec3 Position;
     glm::vec3 Color;
     glm::vec2 UV;
     glm::vec3 Normal;
 
-    static VkVertexInputBindingDescription GetBindingDescription()
+    static std::array<VkVertexInputBindingDescription, VERTEX_STREAM_COUNT> GetBindingDescriptions()
     {
-        VkVertexInputBindingDescription BindingDescription;
-        BindingDescription.binding = 0;
-        BindingDescription.stride = sizeof(Vertex3D);
-        BindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        std::array<VkVertexInputBindingDescription, VERTEX_STREAM_COUNT> BindingDescriptions;
+        BindingDescriptions[VERTEX_STREAM_POSITION].binding = VERTEX_STREAM_POSITION;
+        BindingDescriptions[VERTEX_STREAM_POSITION].stride = sizeof(glm::vec3);
+        BindingDescriptions[VERTEX_STREAM_POSITION].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-        return BindingDescription;
+        BindingDescriptions[VERTEX_STREAM_ATTRIBUTES].binding = VERTEX_STREAM_ATTRIBUTES;
+        BindingDescriptions[VERTEX_STREAM_ATTRIBUTES].stride = sizeof(Vertex3DAttributes);
+        BindingDescriptions[VERTEX_STREAM_ATTRIBUTES].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return BindingDescriptions;
     }
 
     static std::array<VkVertexInputAttributeDescription, 4> GetAttributeDescriptions()
     {
         std::array<VkVertexInputAttributeDescription, 4> AttributeDescriptions{};
-        AttributeDescriptions[0].binding = 0;
+        AttributeDescriptions[0].binding = VERTEX_STREAM_POSITION;
         AttributeDescriptions[0].location = 0;
         AttributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        AttributeDescriptions[0].offset = offsetof(Vertex3D, Position);
+        AttributeDescriptions[0].offset = 0;
 
-        AttributeDescriptions[1].binding = 0;
+        AttributeDescriptions[1].binding = VERTEX_STREAM_ATTRIBUTES;
         AttributeDescriptions[1].location = 1;
         AttributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        AttributeDescriptions[1].offset = offsetof(Vertex3D, Color);
+        AttributeDescriptions[1].offset = offsetof(Vertex3DAttributes, Color);
 
-        AttributeDescriptions[2].binding = 0;
+        AttributeDescriptions[2].binding = VERTEX_STREAM_ATTRIBUTES;
         AttributeDescriptions[2].location = 2;
         AttributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        AttributeDescriptions[2].offset = offsetof(Vertex3D, UV);
+        AttributeDescriptions[2].offset = offsetof(Vertex3DAttributes, UV);
 
-        AttributeDescriptions[3].binding = 0;
+        AttributeDescriptions[3].binding = VERTEX_STREAM_ATTRIBUTES;
         AttributeDescriptions[3].location = 3;
         AttributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
-        AttributeDescriptions[3].offset = offsetof(Vertex3D, Normal);
+        AttributeDescriptions[3].offset = offsetof(Vertex3DAttributes, Normal);
         return AttributeDescriptions;
     }
 };
 
-struct Mesh
+//Layout the vertices of a model take in the geometry store, the CPU side always keeps Vertex3D
+enum class VertexFormat : uint32_t
 {
-    std::vector<Vertex3D> Vertices;
-    std::vector<uint32_t> Indices;
+    Float,
+    Packed
 };
 
-struct Model3D
+const uint32_t VERTEX_FORMAT_COUNT = 2;
+
+//Position quantized to the mesh bounds, the shader gets the bounds through the draw's DrawData
+struct PackedVertexPosition {
+    uint16_t Position[4];
+};
+
+//Half float UV and an octahedral normal, the unused color is dropped
+struct PackedVertexAttributes {
+    uint16_t UV[2];
+    int16_t Normal[2];
+};
+
+//16 byte vertex split over the two streams
+struct PackedVertex3D {
+    static std::array<VkVertexInputBindingDescription, VERTEX_STREAM_COUNT> GetBindingDescriptions()
+    {
+        std::array<VkVertexInputBindingDescription, VERTEX_STREAM_COUNT> BindingDescriptions;
+        BindingDescriptions[VERTEX_STREAM_POSITION].binding = VERTEX_STREAM_POSITION;
+        BindingDescriptions[VERTEX_STREAM_POSITION].stride = sizeof(PackedVertexPosition);
+        BindingDescriptions[VERTEX_STREAM_POSITION].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        BindingDescriptions[VERTEX_STREAM_ATTRIBUTES].binding = VERTEX_STREAM_ATTRIBUTES;
+        BindingDescriptions[VERTEX_STREAM_ATTRIBUTES].stride = sizeof(PackedVertexAttributes);
+        BindingDescriptions[VERTEX_STREAM_ATTRIBUTES].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return BindingDescriptions;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 3> GetAttributeDescriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, 3> AttributeDescriptions{};
+        AttributeDescriptions[0].binding = VERTEX_STREAM_POSITION;
+        AttributeDescriptions[0].location = 0;
+        AttributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        AttributeDescriptions[0].offset = offsetof(PackedVertexPosition, Position);
+
+        AttributeDescriptions[1].binding = VERTEX_STREAM_ATTRIBUTES;
+        AttributeDescriptions[1].location = 1;
+        AttributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+        AttributeDescriptions[1].offset = offsetof(PackedVertexAttributes, UV);
+
+        AttributeDescriptions[2].binding = VERTEX_STREAM_ATTRIBUTES;
+        AttributeDescriptions[2].location = 2;
+        AttributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+        AttributeDescriptions[2].offset = offsetof(PackedVertexAttributes, Normal);
+        return AttributeDescriptions;
+    }
+};
+
+static_assert(sizeof(PackedVertexPosition) + sizeof(PackedVertexAttributes) == 16, "A packed vertex is expected to be 16 bytes");
+
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+//A small cluster of a mesh's triangles with its own vertex list, culled as a whole on the GPU
+struct Meshlet
 {
-    std::vector<Mesh> Meshes;
+    //Offsets into the mesh's MeshletVertices and, in triangles, MeshletTriangles
+    uint32_t VertexOffset;
+    uint32_t TriangleOffset;
+    uint32_t VertexCount;
+    uint32_t TriangleCount;
+    //Center and radius, in mesh space
+    glm::vec4 BoundingSphere;
+    //The meshlet faces away from every viewpoint V with dot(normalize(ConeApex - V), Axis) >= Cutoff, the axis is in xyz and the cutoff in w.
+    //Meshlets whose normals spread too wide get a zero axis and a cutoff of 1 so they are never cone culled.
+    glm::vec4 ConeApex;
+    glm::vec4 ConeAxisCutoff;
+    //Cluster DAG only: the error of the cluster and of the group it was simplified into, each with the sphere it was measured over.
+    //A cluster is drawn when its own error is small enough on screen and its parent's isn't, plain meshlets have no error and an endless parent error.
+    glm::vec4 LodSphere;
+    glm::vec4 ParentLodSphere;
+    float LodError;
+    float ParentLodError;
+    uint32_t Padding[2];
+};
+
+//Axis aligned box and a sphere around the box's center, empty until computed
+struct Bounds3D
+{
+    glm::vec3 Min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 Max = glm::vec3(std::numeric_limits<float>::lowest());
+    glm::vec4 Sphere = glm::vec4(0.0f);
 
-    void GetCombinedVerticesIndicesCount(uint32_t& VertexCount, uint32_t& IndexCount)
+    bool IsEmpty() const
     {
-        VertexCount = IndexCount = 0;
-        for (auto& Mesh : Meshes)
-        {
-            VertexCount += Mesh.Vertices.size();
-            IndexCount += Mesh.Indices.size();
-        }
+        return Min.x > Max.x;
     }
+};
+
+//Arrays of a loaded or cooked model are bumped off one block per model in the order the cooked file stores them, so the whole block
+//loads and cooks with a single copy and the meshes are walked through contiguous memory. Freeing an array placed in it does nothing,
+//the block goes away with its model.
+const size_t GEOMETRY_ARENA_ALIGNMENT = 16;
+
+inline size_t AlignGeometryArenaOffset(size_t Offset)
+{
+    return (Offset + GEOMETRY_ARENA_ALIGNMENT - 1) & ~(GEOMETRY_ARENA_ALIGNMENT - 1);
+}
 
-    void GetCombinedVerticesIndices(std::vector<Vertex3D>& DstCombinedVertices, std::vector<uint32_t>& DstCombinedIndices)
+struct GeometryArena
+{
+    std::unique_ptr<uint8_t[]> Storage;
+    uint8_t* Base = nullptr;
+    size_t Capacity = 0;
+    size_t Used = 0;
+    //Where the arrays laid out like the cooked file's data begin, the mesh's Lods arrays come before them
+    size_t DataOffset = 0;
+
+    explicit GeometryArena(size_t Size) : Storage(new uint8_t[Size + GEOMETRY_ARENA_ALIGNMENT]), Capacity(Size)
     {
-        for (auto& Mesh : Meshes)
-        {
-            DstCombinedVertices.insert(DstCombinedVertices.end(), Mesh.Vertices.begin(), Mesh.Vertices.end());
-            DstCombinedIndices.insert(DstCombinedIndices.end(), Mesh.Indices.begin(), Mesh.Indices.end());
-        }
+        Base = Storage.get() + AlignGeometryArenaOffset(reinterpret_cast<uintptr_t>(Storage.get())) - reinterpret_cast<uintptr_t>(Storage.get());
+    }
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    //Null once the block is full, the padding in between is zeroed so cooked files come out the same every time
+    void* Allocate(size_t Size)
+    {
+        size_t Offset = AlignGeometryArenaOffset(Used);
+        if (Offset + Size > Capacity) return nullptr;
+        memset(Base + Used, 0, Offset - Used);
+        Used = Offset + Size;
+        return Base + Offset;
+    }
+
+    bool Owns(const void* Pointer) const
+    {
+        return Pointer >= Base && Pointer < Base + Capacity;
     }
 };
 
-void Import3Dmodel(const char* FilePath, Model3D& DstModel)
+//Places arrays in an arena when given one and on the heap otherwise, or once the arena is full
+template<typename T>
+struct ArenaAllocator
 {
-    Assimp::Importer Importer;
-    const aiScene* scene = Importer.ReadFile(FilePath,
-        aiProcess_CalcTangentSpace |
-        aiProcess_Triangulate |
-        aiProcess_SortByPType |
-        aiProcess_PreTransformVertices |
-        aiProcess_GenSmoothNormals);
-    aiScene* Scene = const_cast<aiScene*>(scene);
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
 
-    if (nullptr == Scene) {
-        std::cout << "Error code :: " << Importer.GetErrorString() << std::endl;
-        throw std::runtime_error("Unable to import a 3D model(" + std::string(FilePath) + ")");
+    GeometryArena* Arena = nullptr;
+
+    ArenaAllocator() = default;
+    explicit ArenaAllocator(GeometryArena* InArena) : Arena(InArena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& Other) : Arena(Other.Arena) {}
+
+    T* allocate(size_t Count)
+    {
+        void* Memory = Arena != nullptr ? Arena->Allocate(sizeof(T) * Count) : nullptr;
+        return static_cast<T*>(Memory != nullptr ? Memory : ::operator new(sizeof(T) * Count));
     }
 
-    if (!Scene->HasMeshes()) return;
+    void deallocate(T* Pointer, size_t)
+    {
+        if (Arena == nullptr || !Arena->Owns(Pointer)) ::operator delete(Pointer);
+    }
 
-    std::queue<aiNode*> NodesToProcess;
-    NodesToProcess.push(Scene->mRootNode);
-    aiNode* Node = nullptr;
-    while (!NodesToProcess.empty())
+    //Only a model's own arrays live in its arena, copies of them go to the heap
+    ArenaAllocator select_on_container_copy_construction() const
     {
-        Node = NodesToProcess.front();
-        NodesToProcess.pop();
-        for (size_t MeshIndex = 0; MeshIndex < Node->mNumMeshes; MeshIndex++)
-        {
-            Mesh NewMesh;
-            auto& aiMesh = Scene->mMeshes[Node->mMeshes[MeshIndex]];
-            NewMesh.Vertices.reserve(aiMesh->mNumVertices);
-            for (size_t VertexIndex = 0; VertexIndex < aiMesh->mNumVertices; VertexIndex++)
-            {
-                Vertex3D Vertex;
-                auto& AiVertexPosition = aiMesh->mVertices[VertexIndex];
-                Vertex.Position = { AiVertexPosition.x , AiVertexPosition.y , AiVertexPosition.z };
+        return ArenaAllocator();
+    }
+};
 
-                if (aiMesh->HasNormals())
-                {
-                    auto& AiVertexNormal = aiMesh->mNormals[VertexIndex];
-                    Vertex.Normal = { AiVertexNormal.x , AiVertexNormal.y , AiVertexNormal.z };
-                }
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& A, const ArenaAllocator<U>& B)
+{
+    return A.Arena == B.Arena;
+}
 
-                if (aiMesh->HasTextureCoords(0))
-                {
-                    auto& AiVertexTextCoords = aiMesh->mTextureCoords[0][VertexIndex];
-                    Vertex.UV = { AiVertexTextCoords.x , AiVertexTextCoords.y };
-                }
-                NewMesh.Vertices.push_back(Vertex);
-            }
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& A, const ArenaAllocator<U>& B)
+{
+    return A.Arena != B.Arena;
+}
+
+template<typename T>
+using GeometryArray = std::vector<T, ArenaAllocator<T>>;
+
+//A set of triangles over a mesh's vertices together with the meshlets built from them
+struct MeshLod
+{
+    GeometryArray<uint32_t> Indices;
+
+    //Meshlets cover the triangles in index order, every one takes the TriangleCount triangles after the previous one's
+    GeometryArray<Meshlet> Meshlets;
+    GeometryArray<uint32_t> MeshletVertices;
+    //Three indices into the meshlet's vertex list per triangle
+    GeometryArray<uint8_t> MeshletTriangles;
+
+    //How far, in mesh space, the simplified surface may lie from the full detail one, zero at full detail
+    float Error = 0.0f;
+};
+
+//The mesh's own triangles are its full detail level, Lods holds ever coarser simplifications of them that reuse the same vertices
+struct Mesh : MeshLod
+{
+    GeometryArray<Vertex3D> Vertices;
+    GeometryArray<MeshLod> Lods;
+    //Extent of the vertices in mesh space, every level shares it
+    Bounds3D Bounds;
+    //Triangles of every cluster of every level of the cluster DAG, its meshlets are the clusters. Only large meshes get one.
+    MeshLod ClusterDag;
+
+    uint32_t GetLodCount() const
+    {
+        return 1 + static_cast<uint32_t>(Lods.size());
+    }
+
+    const MeshLod& GetLod(uint32_t Level) const
+    {
+        return Level == 0 ? *this : Lods[Level - 1];
+    }
+
+    MeshLod& GetLod(uint32_t Level)
+    {
+        return Level == 0 ? *this : Lods[Level - 1];
+    }
+
+    //The discrete levels followed by the cluster DAG when there is one, as the geometry store and the cooked model lay them out
+    uint32_t GetDrawLevelCount() const
+    {
+        return GetLodCount() + (ClusterDag.Indices.empty() ? 0 : 1);
+    }
+
+    const MeshLod& GetDrawLevel(uint32_t Level) const
+    {
+        return Level < GetLodCount() ? GetLod(Level) : ClusterDag;
+    }
+
+    MeshLod& GetDrawLevel(uint32_t Level)
+    {
+        return Level < GetLodCount() ? GetLod(Level) : ClusterDag;
+    }
+};
+
+//A node of the imported scene graph, it places the meshes NodeMeshes[FirstMesh, FirstMesh + MeshCount) of its model
+struct SceneNode
+{
+    //Relative to the parent node
+    glm::mat4 LocalTransform;
+    //Parents always come before their children, roots have -1
+    int32_t Parent;
+    uint32_t FirstMesh;
+    uint32_t MeshCount;
+    uint32_t Padding;
+};
+
+struct Model3D
+{
+    //Holds the arrays of every mesh once the model is loaded or cooked, declared first so the meshes go before it
+    std::unique_ptr<GeometryArena> Arena;
+    std::vector<Mesh> Meshes;
+    //Scene graph of the source file when the import kept it, meshes are then shared by every node placing them.
+    //Empty when the node transforms were baked into the vertices, every mesh is then placed once as it is.
+    std::vector<SceneNode> Nodes;
+    std::vector<uint32_t> NodeMeshes;
+    //Encloses every placement of every mesh
+    Bounds3D Bounds;
+    //Index of the model's first mesh among all meshes of the scene, the rest follow consecutively
+    uint32_t FirstSceneMesh = 0;
+    VertexFormat Format = VertexFormat::Float;
+
+    //Mesh to model space transform of every placement of every mesh, meshes no node places have none
+    std::vector<std::vector<glm::mat4>> GetMeshInstances() const
+    {
+        std::vector<std::vector<glm::mat4>> Instances(Meshes.size());
+        if (Nodes.empty())
+        {
+            for (auto& MeshInstances : Instances) MeshInstances.push_back(glm::mat4(1.0f));
+            return Instances;
+        }
 
-            NewMesh.Indices.reserve(aiMesh->mNumFaces * 3);
-            for (size_t FaceIndex = 0; FaceIndex < aiMesh->mNumFaces; FaceIndex++)
+        std::vector<glm::mat4> WorldTransforms(Nodes.size());
+        for (size_t NodeIndex = 0; NodeIndex < Nodes.size(); NodeIndex++)
+        {
+            const auto& Node = Nodes[NodeIndex];
+            WorldTransforms[NodeIndex] = Node.Parent < 0 ? Node.LocalTransform : WorldTransforms[Node.Parent] * Node.LocalTransform;
+            for (uint32_t i = Node.FirstMesh; i < Node.FirstMesh + Node.MeshCount; i++)
             {
-                auto& Face = aiMesh->mFaces[FaceIndex];
-                for (size_t Index = 0; Index < Face.mNumIndices; Index++)
+                Instances[NodeMeshes[i]].push_back(WorldTransforms[NodeIndex]);
+            }
+        }
+        return Instances;
+    }
+};
+
+//Where a mesh, or a chunk of one, lives inside the shared geometry buffers.
+//FirstIndex counts in the index type of its section, the indices stay local and are rebased by VertexOffset.
+struct MeshDrawRange
+{
+    uint32_t FirstIndex;
+    int32_t VertexOffset;
+    uint32_t IndexCount;
+    uint32_t SceneMeshIndex;
+    //Level of detail of the scene mesh the range draws, only the ranges of each mesh's selected level are drawn
+    uint32_t Lod;
+    //The range is drawn once per placement of its mesh, reading the DrawData of each from FirstInstance on
+    uint32_t FirstInstance;
+    uint32_t InstanceCount;
+};
+
+//What the LOD selector needs to know of every mesh of the scene
+struct MeshLodInfo
+{
+    //Center and radius of every placement of the mesh in model space, and the largest scale of its transform
+    std::vector<glm::vec4> InstanceSpheres;
+    std::vector<float> InstanceScales;
+    //Simplification error, in mesh space, and triangle count of every discrete level
+    std::vector<float> Errors;
+    std::vector<uint32_t> TriangleCounts;
+    //The cluster DAG is stored as the level after the discrete ones and drawn whenever the culling pass runs, which picks its cut
+    bool HasClusterDag = false;
+};
+
+//Per instance values the vertex shader fetches with gl_InstanceIndex, every draw's firstInstance is its draw range's first instance
+struct DrawData
+{
+    //Mesh to model space, the placement of this instance
+    glm::mat4 Transform;
+    //Packed positions are dequantized as PositionOffset + Position * PositionScale
+    glm::vec4 PositionOffset;
+    glm::vec4 PositionScale;
+};
+
+//Push constants of the culling shader, the frustum planes and the camera are in model space, the shader takes them on into each draw's mesh space
+struct MeshletCullParameters
+{
+    glm::vec4 FrustumPlanes[6];
+    glm::vec3 CameraPosition;
+    uint32_t MeshletCount;
+    //Pixels covered by one unit one unit in front of the camera, and the screen space error the cluster DAG cut aims for
+    float PixelsPerUnit;
+    float PixelErrorThreshold;
+};
+
+//A meshlet, or the part of one inside a single draw range, as the culling shader reads it
+struct MeshletCullData
+{
+    glm::vec4 BoundingSphere;
+    glm::vec4 ConeApex;
+    glm::vec4 ConeAxisCutoff;
+    uint32_t DrawRange;
+    //Into the scene wide meshlet vertex list, whose entries are vertex indices local to the draw range
+    uint32_t VertexOffset;
+    //Into the scene wide triangle list, every triangle packs its three meshlet local indices in the low three bytes
+    uint32_t TriangleOffset;
+    uint32_t TriangleCount;
+    glm::vec4 LodSphere;
+    glm::vec4 ParentLodSphere;
+    float LodError;
+    float ParentLodError;
+    uint32_t Padding[2];
+};
+
+//Draw ranges sharing a vertex format and an index type, they are stored consecutively and drawn with one pipeline and set of bindings
+struct DrawBatch
+{
+    VertexFormat Format = VertexFormat::Float;
+    VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+    VkDeviceSize IndexOffset = 0;
+    uint32_t IndexCount = 0;
+    uint32_t FirstDrawRange = 0;
+    uint32_t DrawRangeCount = 0;
+};
+
+const uint32_t DRAW_BATCH_COUNT = VERTEX_FORMAT_COUNT * 2;
+
+inline uint32_t GetDrawBatchIndex(VertexFormat Format, bool Is16Bit)
+{
+    return static_cast<uint32_t>(Format) * 2 + (Is16Bit ? 0 : 1);
+}
+
+//Vertices and indices of every loaded model packed into one vertex and one index allocation
+struct GeometryStore
+{
+    VkBuffer VertexBuffer = VK_NULL_HANDLE;
+    VmaAllocation VertexBufferAllocation = VK_NULL_HANDLE;
+    VkBuffer IndexBuffer = VK_NULL_HANDLE;
+    VmaAllocation IndexBufferAllocation = VK_NULL_HANDLE;
+
+    //Every stream of every format is kept in its own section, vertex offsets count from the start of the format's sections
+    std::array<std::array<VkDeviceSize, VERTEX_STREAM_COUNT>, VERTEX_FORMAT_COUNT> VertexSectionOffsets{};
+    std::array<uint32_t, VERTEX_FORMAT_COUNT> VertexSectionCounts{};
+    std::vector<MeshDrawRange> DrawRanges;
+    //Indices of every batch follow each other in the index buffer
+    std::array<DrawBatch, DRAW_BATCH_COUNT> DrawBatches;
+
+    VkBuffer DrawDataBuffer = VK_NULL_HANDLE;
+    VmaAllocation DrawDataBufferAllocation = VK_NULL_HANDLE;
+    std::vector<MeshLodInfo> MeshLods;
+
+    //One VkDrawIndexedIndirectCommand per draw range, every frame copies them with the ranges of unselected levels at zero instances
+    std::vector<VkDrawIndexedIndirectCommand> DrawCommands;
+    //The number of draw ranges per batch for the count variant
+    VkBuffer DrawCountBuffer = VK_NULL_HANDLE;
+    VmaAllocation DrawCountBufferAllocation = VK_NULL_HANDLE;
+
+    //Only built when every mesh of the scene has meshlets
+    uint32_t MeshletCount = 0;
+    VkBuffer MeshletBuffer = VK_NULL_HANDLE;
+    VmaAllocation MeshletBufferAllocation = VK_NULL_HANDLE;
+    VkBuffer MeshletVertexBuffer = VK_NULL_HANDLE;
+    VmaAllocation MeshletVertexBufferAllocation = VK_NULL_HANDLE;
+    VkBuffer MeshletTriangleBuffer = VK_NULL_HANDLE;
+    VmaAllocation MeshletTriangleBufferAllocation = VK_NULL_HANDLE;
+    //The draw commands the culling shader starts from: zero index counts and every draw range's slice of the culled index buffer
+    std::vector<VkDrawIndexedIndirectCommand> CulledDrawTemplates;
+    uint32_t CulledIndexCount = 0;
+};
+
+enum class DrawSubmissionMode
+{
+    Direct,
+    Indirect
+};
+
+//Vertex attributes whoever consumes an import reads, Assimp only runs the post-processing steps producing them.
+//Neither vertex format stores tangents, so tangent space is never computed.
+struct ImportProfile
+{
+    bool Normals;
+    bool UVs;
+};
+
+//Both vertex formats shade with normals and UVs
+const ImportProfile IMPORT_PROFILE_SHADED = { true, true };
+//Depth only consumers such as shadow casters or collision proxies just read positions
+const ImportProfile IMPORT_PROFILE_POSITIONS = { false, false };
+
+//Options that change what an import produces, every one of them is part of the cooked model's key
+struct ImportSettings
+{
+    //Attributes kept from the file, missing ones the profile reads get generated
+    ImportProfile Profile = IMPORT_PROFILE_SHADED;
+    //Merges vertices that are bit for bit identical, Assimp emits one per face corner
+    bool WeldVertices = true;
+    //Reorders indices for the post-transform cache, then for overdraw, then vertices for fetch locality
+    bool OptimizeVertexOrder = true;
+    //How much worse than the cache optimized order the overdraw pass may make ACMR
+    float OverdrawThreshold = 1.05f;
+    //Simplified levels built per mesh, each one aiming for LodReduction of the previous level's triangles.
+    //Only vertices away from borders and seams are collapsed, so without welding nothing simplifies.
+    uint32_t LodCount = 4;
+    float LodReduction = 0.5f;
+    //Largest simplification error relative to half the mesh's bounds diagonal, a level that can't get far enough under it ends the chain
+    float LodMaxError = 0.05f;
+    //Splits meshes into meshlets for GPU culling, runs after the reorder so meshlets follow the optimized triangle order
+    bool BuildMeshlets = true;
+    //Meshes with at least this many triangles also get a cluster DAG built on top of their meshlets, 0 disables it
+    uint32_t ClusterDagMinTriangles = 1u << 20;
+    //Keeps the source file's node hierarchy instead of baking every node transform into the vertices, so a mesh placed by many nodes
+    //is stored once and drawn instanced. Off by default as Assimp then no longer merges the meshes that share a material.
+    bool KeepNodeHierarchy = false;
+    //Normals the source lacks are smoothed over the triangles around each position, triangles turning further away than this many degrees
+    //keep a hard edge. 175 is Assimp's default, so models look the way they did when Assimp generated their normals.
+    float NormalCreaseAngle = 175.0f;
+    //Reads OBJ files with the native multithreaded reader, files using anything it doesn't handle still go through Assimp
+    bool NativeObjImport = true;
+    //Imports OBJ files with both readers before cooking and prints how they compare, changes nothing that gets cooked
+    bool BenchmarkObjImport = false;
+    //Only decides how the geometry store lays the vertices out, so it isn't part of the cooked key
+    VertexFormat Format = VertexFormat::Packed;
+};
+
+//Picks a level of detail per mesh every frame, exposed so they can be tuned per scene
+struct LodSelectionSettings
+{
+    //Largest simplification error, in pixels, a level may show at the mesh's projected size
+    float PixelErrorThreshold = 1.0f;
+    //Triangles per frame past which meshes drop to coarser levels regardless of their error, 0 disables the budget
+    uint64_t TriangleBudget = 0;
+};
+
+//Threads a parallel loop started on this thread may use, set on threads that share the hardware with others running at the same
+//time. 0 means every hardware thread.
+thread_local size_t ParallelForThreadBudget = 0;
+
+//Splits [0, Count) into batches that are pulled by one thread per hardware thread, the calling thread included
+void ParallelFor(size_t Count, size_t BatchSize, const std::function<void(size_t Begin, size_t End)>& Body)
+{
+    if (Count == 0) return;
+
+    BatchSize = std::max<size_t>(BatchSize, 1);
+    size_t BatchCount = (Count + BatchSize - 1) / BatchSize;
+    size_t ThreadBudget = ParallelForThreadBudget > 0 ? ParallelForThreadBudget : std::max(1u, std::thread::hardware_concurrency());
+    size_t ThreadCount = std::min(ThreadBudget, BatchCount);
+
+    std::atomic<size_t> NextBatch{ 0 };
+    std::exception_ptr FirstException;
+    std::mutex ExceptionMutex;
+    auto Worker = [&]()
+    {
+        try
+        {
+            for (size_t Batch = NextBatch++; Batch < BatchCount; Batch = NextBatch++)
+            {
+                Body(Batch * BatchSize, std::min(Count, (Batch + 1) * BatchSize));
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> Lock(ExceptionMutex);
+            if (!FirstException) FirstException = std::current_exception();
+            NextBatch = BatchCount;
+        }
+    };
+
+    std::vector<std::thread> Threads;
+    for (size_t i = 1; i < ThreadCount; i++)
+    {
+        Threads.emplace_back(Worker);
+    }
+    Worker();
+    for (auto& Thread : Threads)
+    {
+        Thread.join();
+    }
+
+    if (FirstException) std::rethrow_exception(FirstException);
+}
+
+//The SSE2 paths load a whole 16 byte register at every position, which stays inside the vertex as the color follows the position
+static_assert(offsetof(Vertex3D, Position) + 4 * sizeof(float) <= sizeof(Vertex3D), "A vertex position has to be followed by at least one more float");
+
+void ComputePositionBounds(const Vertex3D* Vertices, size_t VertexCount, glm::vec3& Min, glm::vec3& Max)
+{
+    Min = glm::vec3(std::numeric_limits<float>::max());
+    Max = glm::vec3(std::numeric_limits<float>::lowest());
+#ifdef USE_SSE2
+    //Four independent pairs of accumulators so consecutive vertices don't wait on each other's min and max
+    __m128 Mins[4], Maxs[4];
+    for (int i = 0; i < 4; i++)
+    {
+        Mins[i] = _mm_set1_ps(std::numeric_limits<float>::max());
+        Maxs[i] = _mm_set1_ps(std::numeric_limits<float>::lowest());
+    }
+    size_t Vertex = 0;
+    for (; Vertex + 4 <= VertexCount; Vertex += 4)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            __m128 Position = _mm_loadu_ps(&Vertices[Vertex + i].Position.x);
+            Mins[i] = _mm_min_ps(Mins[i], Position);
+            Maxs[i] = _mm_max_ps(Maxs[i], Position);
+        }
+    }
+    for (; Vertex < VertexCount; Vertex++)
+    {
+        __m128 Position = _mm_loadu_ps(&Vertices[Vertex].Position.x);
+        Mins[0] = _mm_min_ps(Mins[0], Position);
+        Maxs[0] = _mm_max_ps(Maxs[0], Position);
+    }
+
+    alignas(16) float MinLanes[4], MaxLanes[4];
+    _mm_store_ps(MinLanes, _mm_min_ps(_mm_min_ps(Mins[0], Mins[1]), _mm_min_ps(Mins[2], Mins[3])));
+    _mm_store_ps(MaxLanes, _mm_max_ps(_mm_max_ps(Maxs[0], Maxs[1]), _mm_max_ps(Maxs[2], Maxs[3])));
+    Min = glm::vec3(MinLanes[0], MinLanes[1], MinLanes[2]);
+    Max = glm::vec3(MaxLanes[0], MaxLanes[1], MaxLanes[2]);
+#else
+    for (size_t Vertex = 0; Vertex < VertexCount; Vertex++)
+    {
+        Min = glm::min(Min, Vertices[Vertex].Position);
+        Max = glm::max(Max, Vertices[Vertex].Position);
+    }
+#endif
+}
+
+//Largest distance from the center to any of the positions
+float ComputeBoundingRadius(const Vertex3D* Vertices, size_t VertexCount, const glm::vec3& Center)
+{
+    float MaxDistanceSquared = 0.0f;
+    size_t Vertex = 0;
+#ifdef USE_SSE2
+    //Four positions are transposed into x, y and z registers so every lane computes a whole distance
+    const __m128 CenterX = _mm_set1_ps(Center.x), CenterY = _mm_set1_ps(Center.y), CenterZ = _mm_set1_ps(Center.z);
+    __m128 MaxDistances = _mm_setzero_ps();
+    for (; Vertex + 4 <= VertexCount; Vertex += 4)
+    {
+        __m128 X = _mm_loadu_ps(&Vertices[Vertex + 0].Position.x);
+        __m128 Y = _mm_loadu_ps(&Vertices[Vertex + 1].Position.x);
+        __m128 Z = _mm_loadu_ps(&Vertices[Vertex + 2].Position.x);
+        __m128 W = _mm_loadu_ps(&Vertices[Vertex + 3].Position.x);
+        _MM_TRANSPOSE4_PS(X, Y, Z, W);
+        X = _mm_sub_ps(X, CenterX);
+        Y = _mm_sub_ps(Y, CenterY);
+        Z = _mm_sub_ps(Z, CenterZ);
+        __m128 DistancesSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y)), _mm_mul_ps(Z, Z));
+        MaxDistances = _mm_max_ps(MaxDistances, DistancesSquared);
+    }
+
+    alignas(16) float Lanes[4];
+    _mm_store_ps(Lanes, MaxDistances);
+    MaxDistanceSquared = std::max({ Lanes[0], Lanes[1], Lanes[2], Lanes[3] });
+#endif
+    for (; Vertex < VertexCount; Vertex++)
+    {
+        glm::vec3 Offset = Vertices[Vertex].Position - Center;
+        MaxDistanceSquared = std::max(MaxDistanceSquared, glm::dot(Offset, Offset));
+    }
+    return std::sqrt(MaxDistanceSquared);
+}
+
+//Meshes are converted in parallel and big ones are additionally split into chunks of this many vertices or faces
+const size_t IMPORT_CONVERSION_CHUNK_SIZE = 64 * 1024;
+
+//Sphere around the transformed sphere, the radius grows with the transform's largest axis scale
+glm::vec4 TransformSphere(const glm::mat4& Transform, const glm::vec4& Sphere)
+{
+    float Scale = std::max({ glm::length(glm::vec3(Transform[0])), glm::length(glm::vec3(Transform[1])), glm::length(glm::vec3(Transform[2])) });
+    return glm::vec4(glm::vec3(Transform * glm::vec4(glm::vec3(Sphere), 1.0f)), Sphere.w * Scale);
+}
+
+//Bounds of every mesh and of the model around them. Meshes are split into chunks like the conversion does, so a single huge mesh still spreads
+//over every thread: one pass reduces the boxes, a second one measures the sphere around each box's center.
+//The model's sphere encloses the meshes' placed spheres rather than the vertices, which saves another pass over them.
+void ComputeModelBounds(Model3D& DstModel)
+{
+    struct BoundsChunk
+    {
+        uint32_t MeshIndex;
+        size_t Begin;
+        size_t End;
+        glm::vec3 Min;
+        glm::vec3 Max;
+        float Radius;
+    };
+    std::vector<BoundsChunk> Chunks;
+    for (uint32_t MeshIndex = 0; MeshIndex < DstModel.Meshes.size(); MeshIndex++)
+    {
+        size_t VertexCount = DstModel.Meshes[MeshIndex].Vertices.size();
+        for (size_t Begin = 0; Begin < VertexCount; Begin += IMPORT_CONVERSION_CHUNK_SIZE)
+        {
+            Chunks.push_back({ MeshIndex, Begin, std::min(VertexCount, Begin + IMPORT_CONVERSION_CHUNK_SIZE) });
+        }
+    }
+
+    ParallelFor(Chunks.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t ChunkIndex = Begin; ChunkIndex < End; ChunkIndex++)
+        {
+            auto& Chunk = Chunks[ChunkIndex];
+            ComputePositionBounds(DstModel.Meshes[Chunk.MeshIndex].Vertices.data() + Chunk.Begin, Chunk.End - Chunk.Begin, Chunk.Min, Chunk.Max);
+        }
+    });
+    for (auto& Mesh : DstModel.Meshes) Mesh.Bounds = Bounds3D{};
+    for (const auto& Chunk : Chunks)
+    {
+        auto& Bounds = DstModel.Meshes[Chunk.MeshIndex].Bounds;
+        Bounds.Min = glm::min(Bounds.Min, Chunk.Min);
+        Bounds.Max = glm::max(Bounds.Max, Chunk.Max);
+    }
+
+    ParallelFor(Chunks.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t ChunkIndex = Begin; ChunkIndex < End; ChunkIndex++)
+        {
+            auto& Chunk = Chunks[ChunkIndex];
+            const auto& Mesh = DstModel.Meshes[Chunk.MeshIndex];
+            Chunk.Radius = ComputeBoundingRadius(Mesh.Vertices.data() + Chunk.Begin, Chunk.End - Chunk.Begin, (Mesh.Bounds.Min + Mesh.Bounds.Max) * 0.5f);
+        }
+    });
+    for (const auto& Chunk : Chunks)
+    {
+        auto& Bounds = DstModel.Meshes[Chunk.MeshIndex].Bounds;
+        Bounds.Sphere = glm::vec4((Bounds.Min + Bounds.Max) * 0.5f, std::max(Bounds.Sphere.w, Chunk.Radius));
+    }
+
+    //Every placement of a mesh adds the corners of its transformed box, and its sphere moved and grown by the transform's largest scale
+    std::vector<std::vector<glm::mat4>> MeshInstances = DstModel.GetMeshInstances();
+    std::vector<glm::vec4> InstanceSpheres;
+    auto& Bounds = DstModel.Bounds;
+    Bounds = Bounds3D{};
+    for (size_t MeshIndex = 0; MeshIndex < DstModel.Meshes.size(); MeshIndex++)
+    {
+        const auto& MeshBounds = DstModel.Meshes[MeshIndex].Bounds;
+        if (MeshBounds.IsEmpty()) continue;
+        for (const auto& Transform : MeshInstances[MeshIndex])
+        {
+            for (int Corner = 0; Corner < 8; Corner++)
+            {
+                glm::vec3 Position((Corner & 1) ? MeshBounds.Max.x : MeshBounds.Min.x, (Corner & 2) ? MeshBounds.Max.y : MeshBounds.Min.y,
+                    (Corner & 4) ? MeshBounds.Max.z : MeshBounds.Min.z);
+                Position = glm::vec3(Transform * glm::vec4(Position, 1.0f));
+                Bounds.Min = glm::min(Bounds.Min, Position);
+                Bounds.Max = glm::max(Bounds.Max, Position);
+            }
+            InstanceSpheres.push_back(TransformSphere(Transform, MeshBounds.Sphere));
+        }
+    }
+    if (Bounds.IsEmpty()) return;
+
+    glm::vec3 Center = (Bounds.Min + Bounds.Max) * 0.5f;
+    float Radius = 0.0f;
+    for (const auto& Sphere : InstanceSpheres)
+    {
+        Radius = std::max(Radius, glm::length(glm::vec3(Sphere) - Center) + Sphere.w);
+    }
+    Bounds.Sphere = glm::vec4(Center, Radius);
+}
+
+//Appends the node hierarchy breadth first, so parents land before their children, with the meshes referenced past FirstMesh
+void ImportNodeHierarchy(const aiScene* Scene, uint32_t FirstMesh, Model3D& DstModel)
+{
+    struct PendingNode
+    {
+        const aiNode* Node;
+        int32_t Parent;
+    };
+    std::queue<PendingNode> NodesToProcess;
+    NodesToProcess.push({ Scene->mRootNode, -1 });
+    while (!NodesToProcess.empty())
+    {
+        PendingNode Pending = NodesToProcess.front();
+        NodesToProcess.pop();
+
+        //Assimp's matrices are row major
+        const aiMatrix4x4& Transform = Pending.Node->mTransformation;
+        SceneNode NewNode{};
+        NewNode.LocalTransform = glm::mat4(Transform.a1, Transform.b1, Transform.c1, Transform.d1, Transform.a2, Transform.b2, Transform.c2, Transform.d2,
+            Transform.a3, Transform.b3, Transform.c3, Transform.d3, Transform.a4, Transform.b4, Transform.c4, Transform.d4);
+        NewNode.Parent = Pending.Parent;
+        NewNode.FirstMesh = static_cast<uint32_t>(DstModel.NodeMeshes.size());
+        NewNode.MeshCount = Pending.Node->mNumMeshes;
+        for (size_t MeshIndex = 0; MeshIndex < Pending.Node->mNumMeshes; MeshIndex++)
+        {
+            DstModel.NodeMeshes.push_back(FirstMesh + Pending.Node->mMeshes[MeshIndex]);
+        }
+
+        int32_t NodeIndex = static_cast<int32_t>(DstModel.Nodes.size());
+        DstModel.Nodes.push_back(NewNode);
+        for (size_t i = 0; i < Pending.Node->mNumChildren; i++)
+        {
+            NodesToProcess.push({ Pending.Node->mChildren[i], NodeIndex });
+        }
+    }
+}
+
+//Adds a root node placing the meshes [FirstMesh, FirstMesh + MeshCount) once as they are
+void AddIdentityNode(uint32_t FirstMesh, uint32_t MeshCount, Model3D& DstModel)
+{
+    SceneNode NewNode{};
+    NewNode.LocalTransform = glm::mat4(1.0f);
+    NewNode.Parent = -1;
+    NewNode.FirstMesh = static_cast<uint32_t>(DstModel.NodeMeshes.size());
+    NewNode.MeshCount = MeshCount;
+    for (uint32_t MeshIndex = FirstMesh; MeshIndex < FirstMesh + MeshCount; MeshIndex++)
+    {
+        DstModel.NodeMeshes.push_back(MeshIndex);
+    }
+    DstModel.Nodes.push_back(NewNode);
+}
+
+void Import3Dmodel(const char* FilePath, Model3D& DstModel, const ImportSettings& Settings = ImportSettings())
+{
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    //Parse without any post-processing, then run the steps one at a time so the ones a file doesn't need are skipped and each gets timed
+    Assimp::Importer Importer;
+    const aiScene* scene = Importer.ReadFile(FilePath, 0);
+    if (nullptr == scene) {
+        std::cout << "Error code :: " << Importer.GetErrorString() << std::endl;
+        throw std::runtime_error("Unable to import a 3D model(" + std::string(FilePath) + ")");
+    }
+
+    std::vector<std::pair<const char*, double>> StepTimes;
+    StepTimes.push_back({ "read", std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count() });
+    auto RunStep = [&](unsigned int Step, const char* Name)
+    {
+        auto StepStartTime = std::chrono::high_resolution_clock::now();
+        scene = Importer.ApplyPostProcessing(Step);
+        if (nullptr == scene) {
+            std::cout << "Error code :: " << Importer.GetErrorString() << std::endl;
+            throw std::runtime_error("Unable to import a 3D model(" + std::string(FilePath) + ")");
+        }
+        StepTimes.push_back({ Name, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StepStartTime).count() });
+    };
+
+    RunStep(aiProcess_Triangulate, "triangulate");
+    RunStep(aiProcess_SortByPType, "sort by type");
+    if (!Settings.KeepNodeHierarchy)
+    {
+        RunStep(aiProcess_PreTransformVertices, "pretransform");
+    }
+
+    //Only triangle meshes missing an attribute the profile reads need the step generating it, files carrying their own skip it.
+    //Missing normals are left to GenerateModelNormals, Assimp's smooth normals step runs on a single thread.
+    uint32_t MeshesWithoutNormals = 0, MeshesWithoutUVs = 0;
+    for (uint32_t i = 0; i < scene->mNumMeshes; i++)
+    {
+        const aiMesh* Mesh = scene->mMeshes[i];
+        if (Mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE)
+        {
+            MeshesWithoutNormals += !Mesh->HasNormals();
+            MeshesWithoutUVs += !Mesh->HasTextureCoords(0);
+        }
+    }
+    //Turns the spherical, cylindrical or box mappings a material declares into UVs, meshes without any mapping stay without
+    if (Settings.Profile.UVs && MeshesWithoutUVs > 0)
+    {
+        RunStep(aiProcess_GenUVCoords, "uv mapping");
+    }
+
+    std::cout << "Assimp steps ::";
+    for (size_t i = 0; i < StepTimes.size(); i++)
+    {
+        std::cout << (i == 0 ? " " : ", ") << StepTimes[i].first << " " << StepTimes[i].second << "ms";
+    }
+    std::cout << " (" << MeshesWithoutNormals << " of " << scene->mNumMeshes << " meshes without normals, " << MeshesWithoutUVs << " without UVs)" << std::endl;
+
+    aiScene* Scene = const_cast<aiScene*>(scene);
+    if (!Scene->HasMeshes()) return;
+
+    auto ConversionStartTime = std::chrono::high_resolution_clock::now();
+
+    size_t FirstMesh = DstModel.Meshes.size();
+    std::vector<const aiMesh*> SourceMeshes;
+    if (Settings.KeepNodeHierarchy)
+    {
+        //Every mesh once, in the file's order, however many nodes place it
+        SourceMeshes.assign(Scene->mMeshes, Scene->mMeshes + Scene->mNumMeshes);
+        if (DstModel.Nodes.empty() && FirstMesh > 0)
+        {
+            AddIdentityNode(0, static_cast<uint32_t>(FirstMesh), DstModel);
+        }
+        size_t FirstNode = DstModel.Nodes.size(), FirstNodeMesh = DstModel.NodeMeshes.size();
+        ImportNodeHierarchy(Scene, static_cast<uint32_t>(FirstMesh), DstModel);
+        std::cout << "Scene graph :: " << DstModel.Nodes.size() - FirstNode << " nodes place " << SourceMeshes.size() << " meshes "
+            << DstModel.NodeMeshes.size() - FirstNodeMesh << " times" << std::endl;
+    }
+    else
+    {
+        //Gather the meshes breadth first so they keep the order they always had
+        std::queue<aiNode*> NodesToProcess;
+        NodesToProcess.push(Scene->mRootNode);
+        aiNode* Node = nullptr;
+        while (!NodesToProcess.empty())
+        {
+            Node = NodesToProcess.front();
+            NodesToProcess.pop();
+            for (size_t MeshIndex = 0; MeshIndex < Node->mNumMeshes; MeshIndex++)
+            {
+                SourceMeshes.push_back(Scene->mMeshes[Node->mMeshes[MeshIndex]]);
+            }
+
+            for (size_t i = 0; i < Node->mNumChildren; i++)
+            {
+                NodesToProcess.push(*(Node->mChildren + i));
+            }
+        }
+
+        //Added to a model that already has a hierarchy, the baked meshes still need a node to be placed
+        if (!DstModel.Nodes.empty())
+        {
+            AddIdentityNode(static_cast<uint32_t>(FirstMesh), static_cast<uint32_t>(SourceMeshes.size()), DstModel);
+        }
+    }
+
+    DstModel.Meshes.resize(FirstMesh + SourceMeshes.size());
+
+    //Size every output array up front so the chunks below can write into them from any thread
+    std::vector<std::vector<uint32_t>> FaceIndexOffsets(SourceMeshes.size());
+    ParallelFor(SourceMeshes.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t i = Begin; i < End; i++)
+        {
+            const aiMesh* SourceMesh = SourceMeshes[i];
+            auto& NewMesh = DstModel.Meshes[FirstMesh + i];
+            NewMesh.Vertices.resize(SourceMesh->mNumVertices);
+
+            //Triangulated meshes have a fixed stride, anything else needs the offset of every face
+            size_t IndexCount = size_t(SourceMesh->mNumFaces) * 3;
+            if ((SourceMesh->mPrimitiveTypes & ~aiPrimitiveType_NGONEncodingFlag) != aiPrimitiveType_TRIANGLE)
+            {
+                auto& Offsets = FaceIndexOffsets[i];
+                Offsets.resize(SourceMesh->mNumFaces);
+                IndexCount = 0;
+                for (size_t FaceIndex = 0; FaceIndex < SourceMesh->mNumFaces; FaceIndex++)
+                {
+                    Offsets[FaceIndex] = static_cast<uint32_t>(IndexCount);
+                    IndexCount += SourceMesh->mFaces[FaceIndex].mNumIndices;
+                }
+            }
+            NewMesh.Indices.resize(IndexCount);
+        }
+    });
+
+    struct ConversionChunk
+    {
+        uint32_t MeshIndex;
+        bool IsFaceChunk;
+        uint32_t Begin;
+        uint32_t End;
+    };
+    std::vector<ConversionChunk> Chunks;
+    for (uint32_t i = 0; i < SourceMeshes.size(); i++)
+    {
+        for (uint32_t Begin = 0; Begin < SourceMeshes[i]->mNumVertices; Begin += IMPORT_CONVERSION_CHUNK_SIZE)
+        {
+            Chunks.push_back({ i, false, Begin, static_cast<uint32_t>(std::min<size_t>(SourceMeshes[i]->mNumVertices, Begin + IMPORT_CONVERSION_CHUNK_SIZE)) });
+        }
+        for (uint32_t Begin = 0; Begin < SourceMeshes[i]->mNumFaces; Begin += IMPORT_CONVERSION_CHUNK_SIZE)
+        {
+            Chunks.push_back({ i, true, Begin, static_cast<uint32_t>(std::min<size_t>(SourceMeshes[i]->mNumFaces, Begin + IMPORT_CONVERSION_CHUNK_SIZE)) });
+        }
+    }
+
+    ParallelFor(Chunks.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t ChunkIndex = Begin; ChunkIndex < End; ChunkIndex++)
+        {
+            const ConversionChunk& Chunk = Chunks[ChunkIndex];
+            const aiMesh* aiMesh = SourceMeshes[Chunk.MeshIndex];
+            auto& NewMesh = DstModel.Meshes[FirstMesh + Chunk.MeshIndex];
+
+            if (!Chunk.IsFaceChunk)
+            {
+                for (size_t VertexIndex = Chunk.Begin; VertexIndex < Chunk.End; VertexIndex++)
+                {
+                    Vertex3D& Vertex = NewMesh.Vertices[VertexIndex];
+                    auto& AiVertexPosition = aiMesh->mVertices[VertexIndex];
+                    Vertex.Position = { AiVertexPosition.x , AiVertexPosition.y , AiVertexPosition.z };
+
+                    if (Settings.Profile.Normals && aiMesh->HasNormals())
+                    {
+                        auto& AiVertexNormal = aiMesh->mNormals[VertexIndex];
+                        Vertex.Normal = { AiVertexNormal.x , AiVertexNormal.y , AiVertexNormal.z };
+                    }
+
+                    if (Settings.Profile.UVs && aiMesh->HasTextureCoords(0))
+                    {
+                        auto& AiVertexTextCoords = aiMesh->mTextureCoords[0][VertexIndex];
+                        Vertex.UV = { AiVertexTextCoords.x , AiVertexTextCoords.y };
+                    }
+                }
+                continue;
+            }
+
+            const auto& Offsets = FaceIndexOffsets[Chunk.MeshIndex];
+            for (size_t FaceIndex = Chunk.Begin; FaceIndex < Chunk.End; FaceIndex++)
+            {
+                auto& Face = aiMesh->mFaces[FaceIndex];
+                uint32_t* Destination = NewMesh.Indices.data() + (Offsets.empty() ? FaceIndex * 3 : Offsets[FaceIndex]);
+                for (size_t Index = 0; Index < Face.mNumIndices; Index++)
+                {
+                    Destination[Index] = Face.mIndices[Index];
+                }
+            }
+        }
+    });
+
+    auto BoundsStartTime = std::chrono::high_resolution_clock::now();
+    ComputeModelBounds(DstModel);
+
+    auto EndTime = std::chrono::high_resolution_clock::now();
+    std::cout << "Imported " << FilePath << " :: " << SourceMeshes.size() << " meshes, Assimp "
+        << std::chrono::duration<double, std::milli>(ConversionStartTime - StartTime).count() << "ms, conversion "
+        << std::chrono::duration<double, std::milli>(BoundsStartTime - ConversionStartTime).count() << "ms, bounds "
+        << std::chrono::duration<double, std::milli>(EndTime - BoundsStartTime).count() << "ms" << std::endl;
+}
+
+//Size of the FIFO post-transform cache the optimizer and the statistics assume
+const uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStatistics
+{
+    size_t TriangleCount = 0;
+    size_t VertexCount = 0;
+    size_t CacheMisses = 0;
+
+    //Average cache miss ratio, transformed vertices per triangle
+    float GetACMR() const
+    {
+        return TriangleCount == 0 ? 0.0f : float(CacheMisses) / float(TriangleCount);
+    }
+
+    //Average transform to vertex ratio, 1 means every vertex gets transformed exactly once
+    float GetATVR() const
+    {
+        return VertexCount == 0 ? 0.0f : float(CacheMisses) / float(VertexCount);
+    }
+
+    void Add(const VertexCacheStatistics& Other)
+    {
+        TriangleCount += Other.TriangleCount;
+        VertexCount += Other.VertexCount;
+        CacheMisses += Other.CacheMisses;
+    }
+};
+
+//Simulates a FIFO cache with timestamps, a vertex is cached while less than CacheSize misses happened since it was loaded
+inline uint32_t UpdateVertexCache(const uint32_t* Triangle, std::vector<uint32_t>& CacheTimestamps, uint32_t& Timestamp, uint32_t CacheSize)
+{
+    uint32_t Misses = 0;
+    for (size_t k = 0; k < 3; k++)
+    {
+        uint32_t Vertex = Triangle[k];
+        if (Timestamp - CacheTimestamps[Vertex] > CacheSize)
+        {
+            CacheTimestamps[Vertex] = Timestamp++;
+            Misses++;
+        }
+    }
+    return Misses;
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* Indices, size_t IndexCount, size_t VertexCount, uint32_t CacheSize = VERTEX_CACHE_SIZE)
+{
+    VertexCacheStatistics Statistics;
+    Statistics.TriangleCount = IndexCount / 3;
+
+    std::vector<uint32_t> CacheTimestamps(VertexCount, 0);
+    std::vector<bool> IsReferenced(VertexCount, false);
+    uint32_t Timestamp = CacheSize + 1;
+    for (size_t i = 0; i + 2 < IndexCount; i += 3)
+    {
+        Statistics.CacheMisses += UpdateVertexCache(Indices + i, CacheTimestamps, Timestamp, CacheSize);
+        for (size_t k = 0; k < 3; k++)
+        {
+            if (!IsReferenced[Indices[i + k]])
+            {
+                IsReferenced[Indices[i + k]] = true;
+                Statistics.VertexCount++;
+            }
+        }
+    }
+    return Statistics;
+}
+
+//Tipsify (Sander, Nehab, Barczak 2007), fans around the vertex that is still in the cache and has the fewest triangles left
+void OptimizeVertexCache(uint32_t* Destination, const uint32_t* Indices, size_t IndexCount, size_t VertexCount, uint32_t CacheSize = VERTEX_CACHE_SIZE)
+{
+    const uint32_t InvalidVertex = ~0u;
+    size_t TriangleCount = IndexCount / 3;
+    if (TriangleCount == 0) return;
+
+    //Triangles around every vertex
+    std::vector<uint32_t> AdjacencyOffsets(VertexCount + 1, 0);
+    for (size_t i = 0; i < TriangleCount * 3; i++)
+    {
+        AdjacencyOffsets[Indices[i] + 1]++;
+    }
+    for (size_t Vertex = 0; Vertex < VertexCount; Vertex++)
+    {
+        AdjacencyOffsets[Vertex + 1] += AdjacencyOffsets[Vertex];
+    }
+    std::vector<uint32_t> AdjacentTriangles(TriangleCount * 3);
+    std::vector<uint32_t> FillOffsets(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < TriangleCount * 3; i++)
+    {
+        AdjacentTriangles[FillOffsets[Indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<uint32_t> LiveTriangles(VertexCount);
+    for (size_t Vertex = 0; Vertex < VertexCount; Vertex++)
+    {
+        LiveTriangles[Vertex] = AdjacencyOffsets[Vertex + 1] - AdjacencyOffsets[Vertex];
+    }
+
+    std::vector<uint32_t> CacheTimestamps(VertexCount, 0);
+    std::vector<bool> IsEmitted(TriangleCount, false);
+    std::vector<uint32_t> DeadEnds;
+    std::vector<uint32_t> Candidates;
+    uint32_t Timestamp = CacheSize + 1;
+    size_t Cursor = 0;
+    size_t Written = 0;
+
+    uint32_t FanningVertex = 0;
+    while (FanningVertex != InvalidVertex)
+    {
+        Candidates.clear();
+        for (uint32_t i = AdjacencyOffsets[FanningVertex]; i < AdjacencyOffsets[FanningVertex + 1]; i++)
+        {
+            uint32_t Triangle = AdjacentTriangles[i];
+            if (IsEmitted[Triangle]) continue;
+            IsEmitted[Triangle] = true;
+
+            for (size_t k = 0; k < 3; k++)
+            {
+                uint32_t Vertex = Indices[Triangle * 3 + k];
+                Destination[Written++] = Vertex;
+                DeadEnds.push_back(Vertex);
+                Candidates.push_back(Vertex);
+                LiveTriangles[Vertex]--;
+                if (Timestamp - CacheTimestamps[Vertex] > CacheSize)
+                {
+                    CacheTimestamps[Vertex] = Timestamp++;
+                }
+            }
+        }
+
+        //Prefer the oldest cached vertex whose remaining triangles still fit before it gets evicted
+        uint32_t NextVertex = InvalidVertex;
+        uint32_t BestPriority = 0;
+        for (uint32_t Vertex : Candidates)
+        {
+            if (LiveTriangles[Vertex] == 0) continue;
+
+            uint32_t Priority = 0;
+            if (Timestamp - CacheTimestamps[Vertex] + 2 * LiveTriangles[Vertex] <= CacheSize)
+            {
+                Priority = Timestamp - CacheTimestamps[Vertex];
+            }
+            if (Priority > BestPriority)
+            {
+                BestPriority = Priority;
+                NextVertex = Vertex;
+            }
+        }
+
+        //Dead end, go back to a recently emitted vertex or continue with the next one in index order
+        while (NextVertex == InvalidVertex && !DeadEnds.empty())
+        {
+            uint32_t Vertex = DeadEnds.back();
+            DeadEnds.pop_back();
+            if (LiveTriangles[Vertex] > 0) NextVertex = Vertex;
+        }
+        while (NextVertex == InvalidVertex && Cursor < VertexCount)
+        {
+            if (LiveTriangles[Cursor] > 0) NextVertex = static_cast<uint32_t>(Cursor);
+            Cursor++;
+        }
+        FanningVertex = NextVertex;
+    }
+}
+
+//Splits the cache optimized order into clusters and draws the ones facing away from the mesh center first.
+//Clusters are cut where the cache restarts anyway, and are split further as long as ACMR stays within Threshold.
+void OptimizeOverdraw(uint32_t* Destination, const uint32_t* Indices, size_t IndexCount, const Vertex3D* Vertices, size_t VertexCount,
+    float Threshold, uint32_t CacheSize = VERTEX_CACHE_SIZE)
+{
+    size_t TriangleCount = IndexCount / 3;
+    if (TriangleCount == 0) return;
+
+    std::vector<uint32_t> CacheTimestamps(VertexCount, 0);
+    uint32_t Timestamp = CacheSize + 1;
+
+    std::vector<uint32_t> HardBoundaries;
+    for (size_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+    {
+        uint32_t Misses = UpdateVertexCache(Indices + Triangle * 3, CacheTimestamps, Timestamp, CacheSize);
+        if (Triangle == 0 || Misses == 3)
+        {
+            HardBoundaries.push_back(static_cast<uint32_t>(Triangle));
+        }
+    }
+    HardBoundaries.push_back(static_cast<uint32_t>(TriangleCount));
+
+    std::vector<uint32_t> Clusters;
+    for (size_t HardCluster = 0; HardCluster + 1 < HardBoundaries.size(); HardCluster++)
+    {
+        uint32_t Begin = HardBoundaries[HardCluster];
+        uint32_t End = HardBoundaries[HardCluster + 1];
+
+        Timestamp += CacheSize + 1;
+        uint32_t ClusterMisses = 0;
+        for (uint32_t Triangle = Begin; Triangle < End; Triangle++)
+        {
+            ClusterMisses += UpdateVertexCache(Indices + Triangle * 3, CacheTimestamps, Timestamp, CacheSize);
+        }
+        float ClusterThreshold = Threshold * float(ClusterMisses) / float(End - Begin);
+
+        Timestamp += CacheSize + 1;
+        Clusters.push_back(Begin);
+        uint32_t RunningMisses = 0;
+        uint32_t RunningTriangles = 0;
+        for (uint32_t Triangle = Begin; Triangle < End; Triangle++)
+        {
+            RunningMisses += UpdateVertexCache(Indices + Triangle * 3, CacheTimestamps, Timestamp, CacheSize);
+            RunningTriangles++;
+            if (Triangle + 1 < End && float(RunningMisses) / float(RunningTriangles) <= ClusterThreshold)
+            {
+                Clusters.push_back(Triangle + 1);
+                Timestamp += CacheSize + 1;
+                RunningMisses = RunningTriangles = 0;
+            }
+        }
+    }
+    Clusters.push_back(static_cast<uint32_t>(TriangleCount));
+
+    //Area weighted centers and normals
+    auto GetTriangleCross = [&](uint32_t Triangle, glm::vec3& Center)
+    {
+        const glm::vec3& A = Vertices[Indices[Triangle * 3 + 0]].Position;
+        const glm::vec3& B = Vertices[Indices[Triangle * 3 + 1]].Position;
+        const glm::vec3& C = Vertices[Indices[Triangle * 3 + 2]].Position;
+        Center = (A + B + C) / 3.0f;
+        return glm::cross(B - A, C - A);
+    };
+
+    glm::vec3 MeshCenter(0.0f);
+    float MeshArea = 0.0f;
+    for (uint32_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+    {
+        glm::vec3 Center;
+        float Area = glm::length(GetTriangleCross(Triangle, Center));
+        MeshCenter += Center * Area;
+        MeshArea += Area;
+    }
+    MeshCenter = MeshArea > 0.0f ? MeshCenter / MeshArea : glm::vec3(0.0f);
+
+    size_t ClusterCount = Clusters.size() - 1;
+    std::vector<float> SortKeys(ClusterCount);
+    for (size_t Cluster = 0; Cluster < ClusterCount; Cluster++)
+    {
+        glm::vec3 ClusterCenter(0.0f);
+        glm::vec3 ClusterNormal(0.0f);
+        float ClusterArea = 0.0f;
+        for (uint32_t Triangle = Clusters[Cluster]; Triangle < Clusters[Cluster + 1]; Triangle++)
+        {
+            glm::vec3 Center;
+            glm::vec3 Cross = GetTriangleCross(Triangle, Center);
+            float Area = glm::length(Cross);
+            ClusterCenter += Center * Area;
+            ClusterNormal += Cross;
+            ClusterArea += Area;
+        }
+        ClusterCenter = ClusterArea > 0.0f ? ClusterCenter / ClusterArea : ClusterCenter;
+        float NormalLength = glm::length(ClusterNormal);
+        SortKeys[Cluster] = NormalLength > 0.0f ? glm::dot(ClusterCenter - MeshCenter, ClusterNormal / NormalLength) : 0.0f;
+    }
+
+    std::vector<uint32_t> ClusterOrder(ClusterCount);
+    for (size_t Cluster = 0; Cluster < ClusterCount; Cluster++)
+    {
+        ClusterOrder[Cluster] = static_cast<uint32_t>(Cluster);
+    }
+    std::stable_sort(ClusterOrder.begin(), ClusterOrder.end(), [&](uint32_t A, uint32_t B) { return SortKeys[A] > SortKeys[B]; });
+
+    size_t Written = 0;
+    for (uint32_t Cluster : ClusterOrder)
+    {
+        size_t Begin = size_t(Clusters[Cluster]) * 3;
+        size_t End = size_t(Clusters[Cluster + 1]) * 3;
+        memcpy(Destination + Written, Indices + Begin, sizeof(uint32_t) * (End - Begin));
+        Written += End - Begin;
+    }
+}
+
+//Moves vertices into the order they are first referenced and rewrites the indices, unreferenced vertices are dropped
+size_t OptimizeVertexFetch(Vertex3D* Destination, uint32_t* Indices, size_t IndexCount, const Vertex3D* Vertices, size_t VertexCount)
+{
+    const uint32_t Unassigned = ~0u;
+    std::vector<uint32_t> Remap(VertexCount, Unassigned);
+    uint32_t NextVertex = 0;
+    for (size_t i = 0; i < IndexCount; i++)
+    {
+        uint32_t& NewIndex = Remap[Indices[i]];
+        if (NewIndex == Unassigned)
+        {
+            NewIndex = NextVertex++;
+            Destination[NewIndex] = Vertices[Indices[i]];
+        }
+        Indices[i] = NewIndex;
+    }
+    return NextVertex;
+}
+
+void OptimizeMesh(Mesh& DstMesh, const ImportSettings& Settings, VertexCacheStatistics& Before, VertexCacheStatistics& After)
+{
+    auto& Vertices = DstMesh.Vertices;
+    auto& Indices = DstMesh.Indices;
+    if (Indices.empty() || Indices.size() % 3 != 0) return;
+
+    Before = AnalyzeVertexCache(Indices.data(), Indices.size(), Vertices.size());
+
+    std::vector<uint32_t> CacheOrder(Indices.size());
+    OptimizeVertexCache(CacheOrder.data(), Indices.data(), Indices.size(), Vertices.size());
+    OptimizeOverdraw(Indices.data(), CacheOrder.data(), CacheOrder.size(), Vertices.data(), Vertices.size(), Settings.OverdrawThreshold);
+
+    GeometryArray<Vertex3D> FetchOrder(Vertices.size());
+    FetchOrder.resize(OptimizeVertexFetch(FetchOrder.data(), Indices.data(), Indices.size(), Vertices.data(), Vertices.size()));
+    Vertices.swap(FetchOrder);
+
+    After = AnalyzeVertexCache(Indices.data(), Indices.size(), Vertices.size());
+}
+
+void OptimizeModel(Model3D& DstModel, const ImportSettings& Settings)
+{
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    std::vector<VertexCacheStatistics> Before(DstModel.Meshes.size());
+    std::vector<VertexCacheStatistics> After(DstModel.Meshes.size());
+    ParallelFor(DstModel.Meshes.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t MeshIndex = Begin; MeshIndex < End; MeshIndex++)
+        {
+            OptimizeMesh(DstModel.Meshes[MeshIndex], Settings, Before[MeshIndex], After[MeshIndex]);
+        }
+    });
+
+    VertexCacheStatistics TotalBefore, TotalAfter;
+    for (size_t MeshIndex = 0; MeshIndex < DstModel.Meshes.size(); MeshIndex++)
+    {
+        TotalBefore.Add(Before[MeshIndex]);
+        TotalAfter.Add(After[MeshIndex]);
+    }
+
+    double Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count();
+    std::cout << "Vertex order optimization :: ACMR " << TotalBefore.GetACMR() << " -> " << TotalAfter.GetACMR()
+        << ", ATVR " << TotalBefore.GetATVR() << " -> " << TotalAfter.GetATVR() << " (" << Milliseconds << "ms)" << std::endl;
+}
+
+//Gives every vertex the index of the first bit identical one, the unique ones are numbered in order. Returns the unique count.
+//Only the first KeySize bytes of every vertex are compared, sizeof(glm::vec3) matches vertices by position alone.
+size_t GenerateVertexRemap(uint32_t* Remap, const Vertex3D* Vertices, size_t VertexCount, size_t KeySize = sizeof(Vertex3D))
+{
+    const uint32_t EmptySlot = ~0u;
+    size_t TableSize = 1;
+    while (TableSize < VertexCount * 2) TableSize *= 2;
+    std::vector<uint32_t> Table(TableSize, EmptySlot);
+
+    uint32_t UniqueCount = 0;
+    for (size_t Vertex = 0; Vertex < VertexCount; Vertex++)
+    {
+        size_t Slot = HashBytes(&Vertices[Vertex], KeySize) & (TableSize - 1);
+        while (Table[Slot] != EmptySlot && memcmp(&Vertices[Table[Slot]], &Vertices[Vertex], KeySize) != 0)
+        {
+            Slot = (Slot + 1) & (TableSize - 1);
+        }
+
+        if (Table[Slot] == EmptySlot)
+        {
+            Table[Slot] = static_cast<uint32_t>(Vertex);
+            Remap[Vertex] = UniqueCount++;
+        }
+        else
+        {
+            Remap[Vertex] = Remap[Table[Slot]];
+        }
+    }
+    return UniqueCount;
+}
+
+void WeldMesh(Mesh& DstMesh)
+{
+    auto& Vertices = DstMesh.Vertices;
+    std::vector<uint32_t> Remap(Vertices.size());
+    size_t UniqueCount = GenerateVertexRemap(Remap.data(), Vertices.data(), Vertices.size());
+    if (UniqueCount == Vertices.size()) return;
+
+    //Remapped slots never lie past the vertex being moved, so the compaction can run in place
+    for (size_t Vertex = 0; Vertex < Vertices.size(); Vertex++)
+    {
+        Vertices[Remap[Vertex]] = Vertices[Vertex];
+    }
+    Vertices.resize(UniqueCount);
+
+    for (auto& Index : DstMesh.Indices)
+    {
+        Index = Remap[Index];
+    }
+}
+
+void WeldModel(Model3D& DstModel)
+{
+    size_t VertexCountBefore = 0;
+    size_t VertexCountAfter = 0;
+    for (auto& Mesh : DstModel.Meshes) VertexCountBefore += Mesh.Vertices.size();
+
+    ParallelFor(DstModel.Meshes.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t MeshIndex = Begin; MeshIndex < End; MeshIndex++)
+        {
+            WeldMesh(DstModel.Meshes[MeshIndex]);
+        }
+    });
+
+    for (auto& Mesh : DstModel.Meshes) VertexCountAfter += Mesh.Vertices.size();
+    std::cout << "Vertex welding :: " << VertexCountBefore << " -> " << VertexCountAfter << " vertices" << std::endl;
+}
+
+//Normals for the vertices the import left without one, from the area weighted normals of the triangles around their position. Triangles
+//turning further than CreaseAngle degrees away from the vertex's own triangles stay out of the sum, so hard edges stay hard.
+//Every vertex gathers from its own position's triangle list, so the threads never write to shared sums and need no atomics.
+size_t GenerateSmoothNormals(Mesh& DstMesh, float CreaseAngle)
+{
+    auto& Vertices = DstMesh.Vertices;
+    const auto& Indices = DstMesh.Indices;
+    std::vector<uint32_t> Targets;
+    for (uint32_t Vertex = 0; Vertex < Vertices.size(); Vertex++)
+    {
+        const glm::vec3& Normal = Vertices[Vertex].Normal;
+        if (Normal.x == 0.0f && Normal.y == 0.0f && Normal.z == 0.0f) Targets.push_back(Vertex);
+    }
+    if (Targets.empty()) return 0;
+
+    //Cross products are twice as long as their triangle's area, which makes them the weighted normals
+    size_t TriangleCount = Indices.size() / 3;
+    std::vector<glm::vec3> FaceNormals(TriangleCount);
+    ParallelFor(TriangleCount, IMPORT_CONVERSION_CHUNK_SIZE, [&](size_t Begin, size_t End)
+    {
+        for (size_t Triangle = Begin; Triangle < End; Triangle++)
+        {
+            const glm::vec3& A = Vertices[Indices[Triangle * 3 + 0]].Position;
+            const glm::vec3& B = Vertices[Indices[Triangle * 3 + 1]].Position;
+            const glm::vec3& C = Vertices[Indices[Triangle * 3 + 2]].Position;
+            FaceNormals[Triangle] = glm::cross(B - A, C - A);
+        }
+    });
+
+    //Imports give every face corner its own vertex, so smoothing goes by position. Each position lists the triangles touching it in
+    //triangle order, which keeps the sums, and so the cooked model, the same whatever the thread count.
+    std::vector<uint32_t> PositionRemap(Vertices.size());
+    size_t PositionCount = GenerateVertexRemap(PositionRemap.data(), Vertices.data(), Vertices.size(), sizeof(glm::vec3));
+    auto ForEachTrianglePosition = [&](auto&& Body)
+    {
+        for (uint32_t Triangle = 0; Triangle < TriangleCount; Triangle++)
+        {
+            uint32_t A = PositionRemap[Indices[Triangle * 3 + 0]], B = PositionRemap[Indices[Triangle * 3 + 1]], C = PositionRemap[Indices[Triangle * 3 + 2]];
+            Body(A, Triangle);
+            if (B != A) Body(B, Triangle);
+            if (C != A && C != B) Body(C, Triangle);
+        }
+    };
+    std::vector<uint32_t> FirstTriangle(PositionCount + 1, 0);
+    ForEachTrianglePosition([&](uint32_t Position, uint32_t) { FirstTriangle[Position + 1]++; });
+    for (size_t Position = 0; Position < PositionCount; Position++) FirstTriangle[Position + 1] += FirstTriangle[Position];
+    std::vector<uint32_t> PositionTriangles(FirstTriangle.back());
+    std::vector<uint32_t> NextSlot(FirstTriangle.begin(), FirstTriangle.end() - 1);
+    ForEachTrianglePosition([&](uint32_t Position, uint32_t Triangle) { PositionTriangles[NextSlot[Position]++] = Triangle; });
+
+    float CreaseCosine = std::cos(glm::radians(CreaseAngle));
+    std::vector<float> SumX(Targets.size()), SumY(Targets.size()), SumZ(Targets.size());
+    ParallelFor(Targets.size(), 4096, [&](size_t Begin, size_t End)
+    {
+        for (size_t i = Begin; i < End; i++)
+        {
+            uint32_t Vertex = Targets[i];
+            const uint32_t* TrianglesBegin = PositionTriangles.data() + FirstTriangle[PositionRemap[Vertex]];
+            const uint32_t* TrianglesEnd = PositionTriangles.data() + FirstTriangle[PositionRemap[Vertex] + 1];
+
+            //The triangles using the vertex itself decide which side of a crease it is on, a vertex with no area of its own takes every triangle
+            glm::vec3 Own(0.0f);
+            for (const uint32_t* Triangle = TrianglesBegin; Triangle < TrianglesEnd; Triangle++)
+            {
+                const uint32_t* Corners = Indices.data() + size_t(*Triangle) * 3;
+                if (Corners[0] == Vertex || Corners[1] == Vertex || Corners[2] == Vertex) Own += FaceNormals[*Triangle];
+            }
+            float OwnLength = glm::length(Own);
+
+            glm::vec3 Sum(0.0f);
+            for (const uint32_t* Triangle = TrianglesBegin; Triangle < TrianglesEnd; Triangle++)
+            {
+                const glm::vec3& FaceNormal = FaceNormals[*Triangle];
+                if (glm::dot(FaceNormal, Own) >= CreaseCosine * glm::length(FaceNormal) * OwnLength) Sum += FaceNormal;
+            }
+            SumX[i] = Sum.x;
+            SumY[i] = Sum.y;
+            SumZ[i] = Sum.z;
+        }
+
+        size_t i = Begin;
+#ifdef USE_SSE2
+        //Four sums per step, lanes without any area keep a zero normal instead of dividing by zero
+        for (; i + 4 <= End; i += 4)
+        {
+            __m128 X = _mm_loadu_ps(&SumX[i]), Y = _mm_loadu_ps(&SumY[i]), Z = _mm_loadu_ps(&SumZ[i]);
+            __m128 LengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y)), _mm_mul_ps(Z, Z));
+            __m128 Scale = _mm_and_ps(_mm_cmpgt_ps(LengthSquared, _mm_setzero_ps()), _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(LengthSquared)));
+            _mm_storeu_ps(&SumX[i], _mm_mul_ps(X, Scale));
+            _mm_storeu_ps(&SumY[i], _mm_mul_ps(Y, Scale));
+            _mm_storeu_ps(&SumZ[i], _mm_mul_ps(Z, Scale));
+        }
+#endif
+        for (; i < End; i++)
+        {
+            float LengthSquared = SumX[i] * SumX[i] + SumY[i] * SumY[i] + SumZ[i] * SumZ[i];
+            float Scale = LengthSquared > 0.0f ? 1.0f / std::sqrt(LengthSquared) : 0.0f;
+            SumX[i] *= Scale;
+            SumY[i] *= Scale;
+            SumZ[i] *= Scale;
+        }
+
+        for (i = Begin; i < End; i++)
+        {
+            Vertices[Targets[i]].Normal = { SumX[i], SumY[i], SumZ[i] };
+        }
+    });
+    return Targets.size();
+}
+
+void GenerateModelNormals(Model3D& DstModel, const ImportSettings& Settings)
+{
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    //Meshes go one after the other, big ones spread over every thread by themselves and small ones are done before threads would pay off
+    size_t GeneratedCount = 0, MeshCount = 0;
+    for (auto& Mesh : DstModel.Meshes)
+    {
+        size_t Count = GenerateSmoothNormals(Mesh, Settings.NormalCreaseAngle);
+        GeneratedCount += Count;
+        MeshCount += Count > 0;
+    }
+    if (GeneratedCount == 0) return;
+
+    double Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count();
+    std::cout << "Smooth normals :: " << GeneratedCount << " vertices of " << MeshCount << " meshes, " << Milliseconds << "ms" << std::endl;
+}
+
+//Planes of the triangles around a vertex weighted by their area, evaluates to the weighted mean squared distance of a point to them
+struct Quadric
+{
+    double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+    double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+    double C = 0.0;
+    double Weight = 0.0;
+
+    void AddPlane(const glm::dvec3& Normal, double Distance, double PlaneWeight)
+    {
+        A00 += PlaneWeight * Normal.x * Normal.x;
+        A01 += PlaneWeight * Normal.x * Normal.y;
+        A02 += PlaneWeight * Normal.x * Normal.z;
+        A11 += PlaneWeight * Normal.y * Normal.y;
+        A12 += PlaneWeight * Normal.y * Normal.z;
+        A22 += PlaneWeight * Normal.z * Normal.z;
+        B0 += PlaneWeight * Normal.x * Distance;
+        B1 += PlaneWeight * Normal.y * Distance;
+        B2 += PlaneWeight * Normal.z * Distance;
+        C += PlaneWeight * Distance * Distance;
+        Weight += PlaneWeight;
+    }
+
+    void Add(const Quadric& Other)
+    {
+        A00 += Other.A00; A01 += Other.A01; A02 += Other.A02; A11 += Other.A11; A12 += Other.A12; A22 += Other.A22;
+        B0 += Other.B0; B1 += Other.B1; B2 += Other.B2;
+        C += Other.C;
+        Weight += Other.Weight;
+    }
+
+    double Evaluate(const glm::vec3& Point) const
+    {
+        if (Weight == 0.0) return 0.0;
+
+        double X = Point.x, Y = Point.y, Z = Point.z;
+        double Error = A00 * X * X + A11 * Y * Y + A22 * Z * Z + 2.0 * (A01 * X * Y + A02 * X * Z + A12 * Y * Z) + 2.0 * (B0 * X + B1 * Y + B2 * Z) + C;
+        return std::max(Error, 0.0) / Weight;
+    }
+};
+
+//A collapse is refused when it turns a remaining triangle's normal by more than about 75 degrees
+const float SIMPLIFY_MAX_NORMAL_TURN_DOT = 0.25f;
+
+//Collapses edges onto one of their endpoints, cheapest first, until the triangles are down to TargetIndexCount indices or every remaining collapse would
+//move the surface further than TargetError. Vertices on borders and on UV or normal seams stay where they are, so the result reuses the vertices as they are.
+//Writes the simplified indices to Destination, which must hold IndexCount of them, and returns how many there are.
+size_t SimplifyMesh(uint32_t* Destination, const uint32_t* Indices, size_t IndexCount, const Vertex3D* Vertices, size_t VertexCount,
+    size_t TargetIndexCount, float TargetError, float& ResultError)
+{
+    memcpy(Destination, Indices, sizeof(uint32_t) * IndexCount);
+    ResultError = 0.0f;
+    if (IndexCount % 3 != 0) return IndexCount;
+
+    //Seam vertices share their position with another vertex
+    std::vector<uint8_t> IsLocked(VertexCount, 0);
+    std::vector<uint32_t> PositionRemap(VertexCount);
+    GenerateVertexRemap(PositionRemap.data(), Vertices, VertexCount, sizeof(glm::vec3));
+    std::vector<uint32_t> PositionUses(VertexCount, 0);
+    for (size_t Vertex = 0; Vertex < VertexCount; Vertex++) PositionUses[PositionRemap[Vertex]]++;
+    for (size_t Vertex = 0; Vertex < VertexCount; Vertex++) IsLocked[Vertex] = PositionUses[PositionRemap[Vertex]] > 1;
+
+    //Border and non-manifold edges are the ones that don't have exactly two triangles
+    std::vector<uint64_t> Edges;
+    Edges.reserve(IndexCount);
+    for (size_t i = 0; i < IndexCount; i += 3)
+    {
+        for (size_t k = 0; k < 3; k++)
+        {
+            uint32_t A = Indices[i + k], B = Indices[i + (k + 1) % 3];
+            Edges.push_back(uint64_t(std::min(A, B)) << 32 | std::max(A, B));
+        }
+    }
+    std::sort(Edges.begin(), Edges.end());
+    for (size_t Begin = 0, End = 0; Begin < Edges.size(); Begin = End)
+    {
+        while (End < Edges.size() && Edges[End] == Edges[Begin]) End++;
+        if (End - Begin != 2)
+        {
+            IsLocked[Edges[Begin] >> 32] = 1;
+            IsLocked[Edges[Begin] & 0xffffffff] = 1;
+        }
+    }
+
+    std::vector<Quadric> Quadrics(VertexCount);
+    for (size_t i = 0; i < IndexCount; i += 3)
+    {
+        glm::dvec3 P0 = Vertices[Indices[i + 0]].Position, P1 = Vertices[Indices[i + 1]].Position, P2 = Vertices[Indices[i + 2]].Position;
+        glm::dvec3 Normal = glm::cross(P1 - P0, P2 - P0);
+        double Length = glm::length(Normal);
+        if (Length == 0.0) continue;
+
+        Normal /= Length;
+        Quadric Plane;
+        Plane.AddPlane(Normal, -glm::dot(Normal, P0), Length * 0.5);
+        for (size_t k = 0; k < 3; k++) Quadrics[Indices[i + k]].Add(Plane);
+    }
+
+    const float MaxCost = TargetError * TargetError;
+    const size_t TargetTriangleCount = TargetIndexCount / 3;
+    std::vector<float> CollapseCosts(VertexCount);
+    std::vector<uint32_t> CollapseTargets(VertexCount);
+    std::vector<uint32_t> Candidates;
+    std::vector<uint32_t> TriangleOffsets(VertexCount + 1);
+    std::vector<uint32_t> VertexTriangles;
+    std::vector<uint8_t> IsTouched(VertexCount);
+    std::vector<uint32_t> Remap(VertexCount);
+    size_t Count = IndexCount;
+
+    //Every pass collapses a set of edges whose neighbourhoods don't overlap, so the costs and flip tests of one don't change with another
+    while (Count / 3 > TargetTriangleCount)
+    {
+        std::fill(TriangleOffsets.begin(), TriangleOffsets.end(), 0);
+        for (size_t i = 0; i < Count; i++) TriangleOffsets[Destination[i] + 1]++;
+        for (size_t Vertex = 0; Vertex < VertexCount; Vertex++) TriangleOffsets[Vertex + 1] += TriangleOffsets[Vertex];
+        VertexTriangles.resize(Count);
+        for (size_t i = 0; i < Count; i++) VertexTriangles[TriangleOffsets[Destination[i]]++] = static_cast<uint32_t>(i / 3);
+        for (size_t Vertex = VertexCount; Vertex > 0; Vertex--) TriangleOffsets[Vertex] = TriangleOffsets[Vertex - 1];
+        TriangleOffsets[0] = 0;
+
+        //Cheapest edge out of every vertex that may move
+        std::fill(CollapseCosts.begin(), CollapseCosts.end(), std::numeric_limits<float>::max());
+        for (size_t i = 0; i < Count; i += 3)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                for (size_t Other = 1; Other < 3; Other++)
+                {
+                    uint32_t From = Destination[i + k], To = Destination[i + (k + Other) % 3];
+                    if (IsLocked[From]) continue;
+
+                    Quadric Merged = Quadrics[From];
+                    Merged.Add(Quadrics[To]);
+                    float Cost = static_cast<float>(Merged.Evaluate(Vertices[To].Position));
+                    if (Cost < CollapseCosts[From])
+                    {
+                        CollapseCosts[From] = Cost;
+                        CollapseTargets[From] = To;
+                    }
+                }
+            }
+        }
+
+        Candidates.clear();
+        for (uint32_t Vertex = 0; Vertex < VertexCount; Vertex++)
+        {
+            if (CollapseCosts[Vertex] <= MaxCost) Candidates.push_back(Vertex);
+        }
+        std::sort(Candidates.begin(), Candidates.end(), [&](uint32_t A, uint32_t B) { return CollapseCosts[A] < CollapseCosts[B]; });
+
+        std::fill(IsTouched.begin(), IsTouched.end(), 0);
+        for (uint32_t Vertex = 0; Vertex < VertexCount; Vertex++) Remap[Vertex] = Vertex;
+
+        size_t TriangleCount = Count / 3;
+        size_t CollapseCount = 0;
+        for (uint32_t From : Candidates)
+        {
+            if (TriangleCount <= TargetTriangleCount) break;
+            uint32_t To = CollapseTargets[From];
+            if (IsTouched[From] || IsTouched[To]) continue;
+
+            size_t RemovedTriangles = 0;
+            bool IsFlipping = false;
+            for (uint32_t i = TriangleOffsets[From]; i < TriangleOffsets[From + 1] && !IsFlipping; i++)
+            {
+                const uint32_t* Corners = &Destination[VertexTriangles[i] * 3];
+                if (Corners[0] == To || Corners[1] == To || Corners[2] == To)
+                {
+                    RemovedTriangles++;
+                    continue;
+                }
+
+                glm::vec3 Before[3], After[3];
+                for (size_t k = 0; k < 3; k++)
+                {
+                    Before[k] = Vertices[Corners[k]].Position;
+                    After[k] = Corners[k] == From ? Vertices[To].Position : Before[k];
+                }
+                glm::vec3 NormalBefore = glm::cross(Before[1] - Before[0], Before[2] - Before[0]);
+                glm::vec3 NormalAfter = glm::cross(After[1] - After[0], After[2] - After[0]);
+                IsFlipping = glm::dot(NormalBefore, NormalAfter) <= SIMPLIFY_MAX_NORMAL_TURN_DOT * glm::length(NormalBefore) * glm::length(NormalAfter);
+            }
+            if (IsFlipping) continue;
+
+            for (uint32_t i = TriangleOffsets[From]; i < TriangleOffsets[From + 1]; i++)
+            {
+                const uint32_t* Corners = &Destination[VertexTriangles[i] * 3];
+                IsTouched[Corners[0]] = IsTouched[Corners[1]] = IsTouched[Corners[2]] = 1;
+            }
+            Remap[From] = To;
+            Quadrics[To].Add(Quadrics[From]);
+            ResultError = std::max(ResultError, CollapseCosts[From]);
+            TriangleCount -= RemovedTriangles;
+            CollapseCount++;
+        }
+        if (CollapseCount == 0) break;
+
+        //Triangles that lost an edge are now degenerate and dropped
+        size_t NewCount = 0;
+        for (size_t i = 0; i < Count; i += 3)
+        {
+            uint32_t A = Remap[Destination[i + 0]], B = Remap[Destination[i + 1]], C = Remap[Destination[i + 2]];
+            if (A == B || B == C || A == C) continue;
+            Destination[NewCount++] = A;
+            Destination[NewCount++] = B;
+            Destination[NewCount++] = C;
+        }
+        Count = NewCount;
+    }
+
+    ResultError = std::sqrt(ResultError);
+    return Count;
+}
+
+//A level has to drop at least this share of the previous level's triangles, otherwise the chain ends there
+const float LOD_MIN_REDUCTION = 0.15f;
+
+//Simplifies every level from the full detail triangles so errors are always measured against the original surface
+void BuildMeshLods(Mesh& DstMesh, const ImportSettings& Settings)
+{
+    DstMesh.Lods.clear();
+    auto& Indices = DstMesh.Indices;
+    if (Indices.empty() || Indices.size() % 3 != 0) return;
+
+    float MaxError = Settings.LodMaxError * glm::length(DstMesh.Bounds.Max - DstMesh.Bounds.Min) * 0.5f;
+    if (MaxError <= 0.0f) return;
+
+    size_t PreviousIndexCount = Indices.size();
+    for (uint32_t Level = 1; Level <= Settings.LodCount; Level++)
+    {
+        size_t TargetIndexCount = static_cast<size_t>(PreviousIndexCount / 3 * Settings.LodReduction) * 3;
+        std::vector<uint32_t> Simplified(Indices.size());
+        float Error;
+        size_t IndexCount = SimplifyMesh(Simplified.data(), Indices.data(), Indices.size(), DstMesh.Vertices.data(), DstMesh.Vertices.size(),
+            TargetIndexCount, MaxError, Error);
+        if (IndexCount == 0 || IndexCount > PreviousIndexCount * (1.0f - LOD_MIN_REDUCTION)) break;
+
+        MeshLod Lod;
+        Lod.Indices.resize(IndexCount);
+        OptimizeVertexCache(Lod.Indices.data(), Simplified.data(), IndexCount, DstMesh.Vertices.size());
+        Lod.Error = std::max(Error, DstMesh.GetLod(Level - 1).Error);
+        DstMesh.Lods.push_back(std::move(Lod));
+        PreviousIndexCount = IndexCount;
+    }
+}
+
+void BuildModelLods(Model3D& DstModel, const ImportSettings& Settings)
+{
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    ParallelFor(DstModel.Meshes.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t MeshIndex = Begin; MeshIndex < End; MeshIndex++)
+        {
+            BuildMeshLods(DstModel.Meshes[MeshIndex], Settings);
+        }
+    });
+
+    uint32_t LevelCount = 1;
+    for (auto& Mesh : DstModel.Meshes) LevelCount = std::max(LevelCount, Mesh.GetLodCount());
+    std::vector<size_t> LevelTriangleCounts(LevelCount, 0);
+    for (auto& Mesh : DstModel.Meshes)
+    {
+        for (uint32_t Level = 0; Level < LevelTriangleCounts.size(); Level++)
+        {
+            //Meshes with a shorter chain count with their coarsest level
+            LevelTriangleCounts[Level] += Mesh.GetLod(std::min(Level, Mesh.GetLodCount() - 1)).Indices.size() / 3;
+        }
+    }
+
+    double Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count();
+    std::cout << "LOD chain :: ";
+    for (size_t Level = 0; Level < LevelTriangleCounts.size(); Level++)
+    {
+        std::cout << (Level == 0 ? "" : " -> ") << LevelTriangleCounts[Level];
+    }
+    std::cout << " triangles (" << Milliseconds << "ms)" << std::endl;
+}
+
+//Normal cones whose narrowest triangle is closer than this to perpendicular are treated as never back facing
+const float MESHLET_MIN_CONE_DOT = 0.1f;
+
+void ComputeMeshletBounds(const GeometryArray<Vertex3D>& Vertices, const MeshLod& SrcLod, Meshlet& DstMeshlet)
+{
+    const uint32_t* MeshletVertices = SrcLod.MeshletVertices.data() + DstMeshlet.VertexOffset;
+    const uint8_t* MeshletTriangles = SrcLod.MeshletTriangles.data() + DstMeshlet.TriangleOffset * 3;
+
+    glm::vec3 Min(std::numeric_limits<float>::max());
+    glm::vec3 Max(std::numeric_limits<float>::lowest());
+    for (uint32_t Vertex = 0; Vertex < DstMeshlet.VertexCount; Vertex++)
+    {
+        Min = glm::min(Min, Vertices[MeshletVertices[Vertex]].Position);
+        Max = glm::max(Max, Vertices[MeshletVertices[Vertex]].Position);
+    }
+    glm::vec3 Center = (Min + Max) * 0.5f;
+    float Radius = 0.0f;
+    for (uint32_t Vertex = 0; Vertex < DstMeshlet.VertexCount; Vertex++)
+    {
+        Radius = std::max(Radius, glm::length(Vertices[MeshletVertices[Vertex]].Position - Center));
+    }
+    DstMeshlet.BoundingSphere = glm::vec4(Center, Radius);
+    DstMeshlet.ConeApex = glm::vec4(Center, 0.0f);
+    DstMeshlet.ConeAxisCutoff = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    //Degenerate triangles face nowhere and don't widen the cone
+    std::array<glm::vec3, MESHLET_MAX_TRIANGLES> Normals;
+    std::array<glm::vec3, MESHLET_MAX_TRIANGLES> Corners;
+    uint32_t NormalCount = 0;
+    glm::vec3 AxisSum(0.0f);
+    for (uint32_t Triangle = 0; Triangle < DstMeshlet.TriangleCount; Triangle++)
+    {
+        const glm::vec3& P0 = Vertices[MeshletVertices[MeshletTriangles[Triangle * 3 + 0]]].Position;
+        const glm::vec3& P1 = Vertices[MeshletVertices[MeshletTriangles[Triangle * 3 + 1]]].Position;
+        const glm::vec3& P2 = Vertices[MeshletVertices[MeshletTriangles[Triangle * 3 + 2]]].Position;
+        glm::vec3 Normal = glm::cross(P1 - P0, P2 - P0);
+        float Length = glm::length(Normal);
+        if (Length == 0.0f) continue;
+
+        Normals[NormalCount] = Normal / Length;
+        Corners[NormalCount] = P0;
+        AxisSum += Normals[NormalCount];
+        NormalCount++;
+    }
+
+    float AxisLength = glm::length(AxisSum);
+    if (NormalCount == 0 || AxisLength == 0.0f) return;
+
+    glm::vec3 Axis = AxisSum / AxisLength;
+    float MinDot = 1.0f;
+    for (uint32_t i = 0; i < NormalCount; i++)
+    {
+        MinDot = std::min(MinDot, glm::dot(Axis, Normals[i]));
+    }
+    if (MinDot <= MESHLET_MIN_CONE_DOT) return;
+
+    //Slide the apex back along the axis until every triangle's plane lies in front of it
+    float MaxDistance = 0.0f;
+    for (uint32_t i = 0; i < NormalCount; i++)
+    {
+        MaxDistance = std::max(MaxDistance, glm::dot(Center - Corners[i], Normals[i]) / glm::dot(Axis, Normals[i]));
+    }
+    DstMeshlet.ConeApex = glm::vec4(Center - Axis * MaxDistance, 0.0f);
+    DstMeshlet.ConeAxisCutoff = glm::vec4(Axis, std::sqrt(1.0f - MinDot * MinDot));
+}
+
+//Greedily fills meshlets in index order, which the vertex order optimization already made spatially coherent
+void BuildMeshlets(const GeometryArray<Vertex3D>& Vertices, MeshLod& DstLod)
+{
+    auto& Indices = DstLod.Indices;
+    DstLod.Meshlets.clear();
+    DstLod.MeshletVertices.clear();
+    DstLod.MeshletTriangles.clear();
+    if (Indices.empty() || Indices.size() % 3 != 0) return;
+
+    const uint8_t NotInMeshlet = 0xff;
+    std::vector<uint8_t> LocalVertices(Vertices.size(), NotInMeshlet);
+
+    Meshlet Current{};
+    auto FinishMeshlet = [&]()
+    {
+        if (Current.TriangleCount == 0) return;
+        ComputeMeshletBounds(Vertices, DstLod, Current);
+        Current.LodSphere = Current.ParentLodSphere = Current.BoundingSphere;
+        Current.ParentLodError = std::numeric_limits<float>::max();
+        DstLod.Meshlets.push_back(Current);
+        for (uint32_t Vertex = 0; Vertex < Current.VertexCount; Vertex++)
+        {
+            LocalVertices[DstLod.MeshletVertices[Current.VertexOffset + Vertex]] = NotInMeshlet;
+        }
+
+        Current = Meshlet{};
+        Current.VertexOffset = static_cast<uint32_t>(DstLod.MeshletVertices.size());
+        Current.TriangleOffset = static_cast<uint32_t>(DstLod.MeshletTriangles.size() / 3);
+    };
+
+    for (size_t Triangle = 0; Triangle < Indices.size(); Triangle += 3)
+    {
+        const uint32_t* Corners = &Indices[Triangle];
+        uint32_t NewVertexCount = 0;
+        for (uint32_t Corner = 0; Corner < 3; Corner++)
+        {
+            bool IsRepeated = (Corner > 0 && Corners[Corner] == Corners[0]) || (Corner > 1 && Corners[Corner] == Corners[1]);
+            if (LocalVertices[Corners[Corner]] == NotInMeshlet && !IsRepeated) NewVertexCount++;
+        }
+
+        if (Current.VertexCount + NewVertexCount > MESHLET_MAX_VERTICES || Current.TriangleCount == MESHLET_MAX_TRIANGLES)
+        {
+            FinishMeshlet();
+        }
+
+        for (uint32_t Corner = 0; Corner < 3; Corner++)
+        {
+            uint8_t& LocalVertex = LocalVertices[Corners[Corner]];
+            if (LocalVertex == NotInMeshlet)
+            {
+                LocalVertex = static_cast<uint8_t>(Current.VertexCount++);
+                DstLod.MeshletVertices.push_back(Corners[Corner]);
+            }
+            DstLod.MeshletTriangles.push_back(LocalVertex);
+        }
+        Current.TriangleCount++;
+    }
+    FinishMeshlet();
+}
+
+void BuildModelMeshlets(Model3D& DstModel)
+{
+    ParallelFor(DstModel.Meshes.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t MeshIndex = Begin; MeshIndex < End; MeshIndex++)
+        {
+            auto& Mesh = DstModel.Meshes[MeshIndex];
+            for (uint32_t Level = 0; Level < Mesh.GetLodCount(); Level++)
+            {
+                BuildMeshlets(Mesh.Vertices, Mesh.GetLod(Level));
+            }
+        }
+    });
+
+    size_t MeshletCount = 0, VertexCount = 0, TriangleCount = 0;
+    for (auto& Mesh : DstModel.Meshes)
+    {
+        for (uint32_t Level = 0; Level < Mesh.GetLodCount(); Level++)
+        {
+            const auto& Lod = Mesh.GetLod(Level);
+            MeshletCount += Lod.Meshlets.size();
+            VertexCount += Lod.MeshletVertices.size();
+            TriangleCount += Lod.MeshletTriangles.size() / 3;
+        }
+    }
+    if (MeshletCount == 0) return;
+    std::cout << "Meshlets :: " << MeshletCount << " meshlets, " << float(VertexCount) / MeshletCount << " vertices and "
+        << float(TriangleCount) / MeshletCount << " triangles per meshlet" << std::endl;
+}
+
+//Clusters merged into one group before it is simplified, and the most levels a cluster DAG may get
+const uint32_t CLUSTER_DAG_GROUP_SIZE = 8;
+const uint32_t CLUSTER_DAG_MAX_LEVELS = 32;
+
+//A cluster while the DAG is built, its triangles index the mesh's vertices
+struct ClusterDagNode
+{
+    std::vector<uint32_t> Indices;
+    glm::vec4 LodSphere;
+    float LodError = 0.0f;
+    glm::vec4 ParentLodSphere;
+    float ParentLodError = std::numeric_limits<float>::max();
+};
+
+//Smallest sphere around both spheres
+glm::vec4 MergeSpheres(const glm::vec4& A, const glm::vec4& B)
+{
+    glm::vec3 Offset = glm::vec3(B) - glm::vec3(A);
+    float Distance = glm::length(Offset);
+    if (Distance + B.w <= A.w) return A;
+    if (Distance + A.w <= B.w) return B;
+
+    float Radius = (Distance + A.w + B.w) * 0.5f;
+    return glm::vec4(glm::vec3(A) + Offset * ((Radius - A.w) / Distance), Radius);
+}
+
+//Greedily grows groups of up to CLUSTER_DAG_GROUP_SIZE clusters, each time taking the ungrouped cluster that shares the most vertices with the group
+std::vector<std::vector<uint32_t>> GroupClusters(const std::vector<ClusterDagNode>& Nodes, const std::vector<uint32_t>& Level, size_t VertexCount)
+{
+    std::vector<uint32_t> VertexOffsets(VertexCount + 1, 0);
+    for (uint32_t Cluster : Level)
+    {
+        for (uint32_t Index : Nodes[Cluster].Indices) VertexOffsets[Index + 1]++;
+    }
+    for (size_t Vertex = 0; Vertex < VertexCount; Vertex++) VertexOffsets[Vertex + 1] += VertexOffsets[Vertex];
+    std::vector<uint32_t> VertexClusters(VertexOffsets[VertexCount]);
+    std::vector<uint32_t> Cursor(VertexOffsets.begin(), VertexOffsets.end() - 1);
+    for (uint32_t LevelCluster = 0; LevelCluster < Level.size(); LevelCluster++)
+    {
+        for (uint32_t Index : Nodes[Level[LevelCluster]].Indices) VertexClusters[Cursor[Index]++] = LevelCluster;
+    }
+
+    //Neighbours of every cluster with the number of vertex references they share
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> Neighbours(Level.size());
+    std::vector<uint32_t> Shared;
+    for (uint32_t LevelCluster = 0; LevelCluster < Level.size(); LevelCluster++)
+    {
+        Shared.clear();
+        for (uint32_t Index : Nodes[Level[LevelCluster]].Indices)
+        {
+            for (uint32_t i = VertexOffsets[Index]; i < VertexOffsets[Index + 1]; i++)
+            {
+                if (VertexClusters[i] != LevelCluster) Shared.push_back(VertexClusters[i]);
+            }
+        }
+        std::sort(Shared.begin(), Shared.end());
+        for (size_t Begin = 0, End = 0; Begin < Shared.size(); Begin = End)
+        {
+            while (End < Shared.size() && Shared[End] == Shared[Begin]) End++;
+            Neighbours[LevelCluster].push_back({ Shared[Begin], static_cast<uint32_t>(End - Begin) });
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> Groups;
+    std::vector<uint8_t> IsGrouped(Level.size(), 0);
+    for (uint32_t Seed = 0; Seed < Level.size(); Seed++)
+    {
+        if (IsGrouped[Seed]) continue;
+
+        std::vector<uint32_t> Group = { Seed };
+        IsGrouped[Seed] = 1;
+        while (Group.size() < CLUSTER_DAG_GROUP_SIZE)
+        {
+            uint32_t Best = ~0u, BestShared = 0;
+            for (uint32_t Member : Group)
+            {
+                for (const auto& Neighbour : Neighbours[Member])
+                {
+                    if (!IsGrouped[Neighbour.first] && Neighbour.second > BestShared)
+                    {
+                        Best = Neighbour.first;
+                        BestShared = Neighbour.second;
+                    }
+                }
+            }
+            if (Best == ~0u) break;
+            Group.push_back(Best);
+            IsGrouped[Best] = 1;
+        }
+
+        for (auto& Member : Group) Member = Level[Member];
+        Groups.push_back(std::move(Group));
+    }
+    return Groups;
+}
+
+//Simplifies a group's merged triangles to half over a compact copy of the vertices they use. The group's outline is made of edges with a single
+//triangle inside the group, which SimplifyMesh keeps in place, so the result still matches the neighbouring groups whichever level they are drawn at.
+bool SimplifyClusterGroup(const GeometryArray<Vertex3D>& Vertices, const std::vector<uint32_t>& Indices, float MaxError, GeometryArray<uint32_t>& Simplified, float& Error)
+{
+    std::vector<uint32_t> GroupVertices(Indices);
+    std::sort(GroupVertices.begin(), GroupVertices.end());
+    GroupVertices.erase(std::unique(GroupVertices.begin(), GroupVertices.end()), GroupVertices.end());
+
+    std::vector<Vertex3D> LocalVertices(GroupVertices.size());
+    for (size_t Vertex = 0; Vertex < GroupVertices.size(); Vertex++) LocalVertices[Vertex] = Vertices[GroupVertices[Vertex]];
+    std::vector<uint32_t> LocalIndices(Indices.size());
+    for (size_t i = 0; i < Indices.size(); i++)
+    {
+        LocalIndices[i] = static_cast<uint32_t>(std::lower_bound(GroupVertices.begin(), GroupVertices.end(), Indices[i]) - GroupVertices.begin());
+    }
+
+    Simplified.resize(Indices.size());
+    size_t IndexCount = SimplifyMesh(Simplified.data(), LocalIndices.data(), LocalIndices.size(), LocalVertices.data(), LocalVertices.size(),
+        Indices.size() / 6 * 3, MaxError, Error);
+    if (IndexCount == 0 || IndexCount > Indices.size() * (1.0f - LOD_MIN_REDUCTION)) return false;
+
+    //Cache order keeps neighbouring triangles together, so the clusters split from the result stay compact instead of becoming thin strips
+    std::vector<uint32_t> CacheOrder(IndexCount);
+    OptimizeVertexCache(CacheOrder.data(), Simplified.data(), IndexCount, LocalVertices.size());
+    Simplified.resize(IndexCount);
+    for (size_t i = 0; i < IndexCount; i++) Simplified[i] = GroupVertices[CacheOrder[i]];
+    return true;
+}
+
+//Builds the DAG bottom up from the mesh's meshlets: clusters are grouped with their neighbours, every group is simplified to half and split into new
+//clusters, which form the next level. A group's error adds its simplification error to the largest error below it and its sphere encloses those
+//of its clusters, so errors only grow towards the roots and the per cluster test of the culling pass always picks one consistent cut.
+void BuildClusterDag(Mesh& DstMesh)
+{
+    auto& Dag = DstMesh.ClusterDag;
+    Dag = MeshLod{};
+    if (DstMesh.Meshlets.empty()) return;
+
+    float MaxError = glm::length(DstMesh.Bounds.Max - DstMesh.Bounds.Min) * 0.5f;
+
+    std::vector<ClusterDagNode> Nodes;
+    std::vector<uint32_t> Level;
+    for (const auto& SrcMeshlet : DstMesh.Meshlets)
+    {
+        ClusterDagNode Node;
+        for (uint32_t Corner = 0; Corner < SrcMeshlet.TriangleCount * 3; Corner++)
+        {
+            Node.Indices.push_back(DstMesh.MeshletVertices[SrcMeshlet.VertexOffset + DstMesh.MeshletTriangles[SrcMeshlet.TriangleOffset * 3 + Corner]]);
+        }
+        Node.LodSphere = Node.ParentLodSphere = SrcMeshlet.BoundingSphere;
+        Level.push_back(static_cast<uint32_t>(Nodes.size()));
+        Nodes.push_back(std::move(Node));
+    }
+
+    uint32_t LevelCount = 1;
+    while (Level.size() > 1 && LevelCount < CLUSTER_DAG_MAX_LEVELS)
+    {
+        std::vector<std::vector<uint32_t>> Groups = GroupClusters(Nodes, Level, DstMesh.Vertices.size());
+        std::vector<MeshLod> GroupClusterSets(Groups.size());
+        std::vector<float> GroupErrors(Groups.size(), 0.0f);
+        std::vector<glm::vec4> GroupSpheres(Groups.size());
+        std::vector<uint8_t> IsSimplified(Groups.size(), 0);
+        ParallelFor(Groups.size(), 16, [&](size_t Begin, size_t End)
+        {
+            std::vector<uint32_t> Merged;
+            for (size_t GroupIndex = Begin; GroupIndex < End; GroupIndex++)
+            {
+                const auto& Group = Groups[GroupIndex];
+                Merged.clear();
+                float ChildError = 0.0f;
+                glm::vec4 Sphere = Nodes[Group[0]].LodSphere;
+                for (uint32_t Cluster : Group)
+                {
+                    Merged.insert(Merged.end(), Nodes[Cluster].Indices.begin(), Nodes[Cluster].Indices.end());
+                    ChildError = std::max(ChildError, Nodes[Cluster].LodError);
+                    Sphere = MergeSpheres(Sphere, Nodes[Cluster].LodSphere);
+                }
+
+                float Error;
+                auto& ClusterSet = GroupClusterSets[GroupIndex];
+                if (!SimplifyClusterGroup(DstMesh.Vertices, Merged, MaxError, ClusterSet.Indices, Error)) continue;
+
+                BuildMeshlets(DstMesh.Vertices, ClusterSet);
+                GroupErrors[GroupIndex] = ChildError + Error;
+                GroupSpheres[GroupIndex] = Sphere;
+                IsSimplified[GroupIndex] = 1;
+            }
+        });
+
+        //Clusters of groups that didn't simplify move up unchanged, so they can be grouped with other neighbours on the next level
+        std::vector<uint32_t> NextLevel;
+        bool IsAnySimplified = false;
+        for (size_t GroupIndex = 0; GroupIndex < Groups.size(); GroupIndex++)
+        {
+            if (!IsSimplified[GroupIndex])
+            {
+                NextLevel.insert(NextLevel.end(), Groups[GroupIndex].begin(), Groups[GroupIndex].end());
+                continue;
+            }
+            IsAnySimplified = true;
+
+            for (uint32_t Cluster : Groups[GroupIndex])
+            {
+                Nodes[Cluster].ParentLodSphere = GroupSpheres[GroupIndex];
+                Nodes[Cluster].ParentLodError = GroupErrors[GroupIndex];
+            }
+
+            const auto& ClusterSet = GroupClusterSets[GroupIndex];
+            for (const auto& NewMeshlet : ClusterSet.Meshlets)
+            {
+                ClusterDagNode Node;
+                for (uint32_t Corner = 0; Corner < NewMeshlet.TriangleCount * 3; Corner++)
+                {
+                    Node.Indices.push_back(ClusterSet.MeshletVertices[NewMeshlet.VertexOffset + ClusterSet.MeshletTriangles[NewMeshlet.TriangleOffset * 3 + Corner]]);
+                }
+                Node.LodSphere = Node.ParentLodSphere = GroupSpheres[GroupIndex];
+                Node.LodError = GroupErrors[GroupIndex];
+                NextLevel.push_back(static_cast<uint32_t>(Nodes.size()));
+                Nodes.push_back(std::move(Node));
+            }
+        }
+        if (!IsAnySimplified) break;
+
+        Level.swap(NextLevel);
+        LevelCount++;
+    }
+
+    //Every node becomes exactly one meshlet of the DAG, as it was cut from a meshlet it always fits in one
+    for (const auto& Node : Nodes)
+    {
+        MeshLod NodeMeshlet;
+        NodeMeshlet.Indices.assign(Node.Indices.begin(), Node.Indices.end());
+        BuildMeshlets(DstMesh.Vertices, NodeMeshlet);
+
+        Meshlet DagMeshlet = NodeMeshlet.Meshlets[0];
+        DagMeshlet.VertexOffset = static_cast<uint32_t>(Dag.MeshletVertices.size());
+        DagMeshlet.TriangleOffset = static_cast<uint32_t>(Dag.MeshletTriangles.size() / 3);
+        DagMeshlet.LodSphere = Node.LodSphere;
+        DagMeshlet.LodError = Node.LodError;
+        DagMeshlet.ParentLodSphere = Node.ParentLodSphere;
+        DagMeshlet.ParentLodError = Node.ParentLodError;
+        Dag.Meshlets.push_back(DagMeshlet);
+        Dag.Indices.insert(Dag.Indices.end(), Node.Indices.begin(), Node.Indices.end());
+        Dag.MeshletVertices.insert(Dag.MeshletVertices.end(), NodeMeshlet.MeshletVertices.begin(), NodeMeshlet.MeshletVertices.end());
+        Dag.MeshletTriangles.insert(Dag.MeshletTriangles.end(), NodeMeshlet.MeshletTriangles.begin(), NodeMeshlet.MeshletTriangles.end());
+        Dag.Error = std::max(Dag.Error, Node.LodError);
+    }
+}
+
+void BuildModelClusterDags(Model3D& DstModel, const ImportSettings& Settings)
+{
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    size_t MeshCount = 0, ClusterCount = 0, TriangleCount = 0;
+    for (auto& Mesh : DstModel.Meshes)
+    {
+        Mesh.ClusterDag = MeshLod{};
+        if (Mesh.Indices.size() / 3 < Settings.ClusterDagMinTriangles) continue;
+
+        //The groups of every level are simplified in parallel, so the meshes are done one after the other
+        BuildClusterDag(Mesh);
+        MeshCount += Mesh.ClusterDag.Meshlets.empty() ? 0 : 1;
+        ClusterCount += Mesh.ClusterDag.Meshlets.size();
+        TriangleCount += Mesh.ClusterDag.Indices.size() / 3;
+    }
+    if (MeshCount == 0) return;
+
+    double Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count();
+    std::cout << "Cluster DAG :: " << MeshCount << " meshes, " << ClusterCount << " clusters, " << TriangleCount << " triangles over all levels ("
+        << Milliseconds << "ms)" << std::endl;
+}
+
+//A run of a mesh's triangles that is drawn on its own.
+//Chunks of split meshes carry their own vertex list so their indices fit in 16 bits.
+struct IndexChunk
+{
+    uint32_t FirstIndex = 0;
+    uint32_t IndexCount = 0;
+    bool Is16Bit = true;
+    //Mesh vertex behind every chunk vertex, empty when the chunk indexes the mesh's vertices directly
+    std::vector<uint32_t> SourceVertices;
+    std::vector<uint16_t> LocalIndices;
+};
+
+//How many more vertices a split mesh may have due to vertices shared between its chunks, beyond that it stays 32-bit
+const float MAX_CHUNK_VERTEX_DUPLICATION = 1.25f;
+
+//Meshes with up to 65536 vertices use 16-bit indices as they are. Bigger ones are cut into runs of triangles that
+//reference at most 65536 unique vertices, which is cheap to do as the optimized index order keeps neighbours together.
+void SplitIndexChunks(const uint32_t* Indices, size_t IndexCount, size_t VertexCount, std::vector<IndexChunk>& Chunks)
+{
+    const size_t MaxChunkVertices = 0x10000;
+    Chunks.clear();
+    if (IndexCount == 0) return;
+
+    if (VertexCount <= MaxChunkVertices)
+    {
+        Chunks.emplace_back();
+        Chunks.back().IndexCount = static_cast<uint32_t>(IndexCount);
+        return;
+    }
+
+    if (IndexCount % 3 == 0)
+    {
+        const uint32_t NoChunk = ~0u;
+        std::vector<uint32_t> VertexChunk(VertexCount, NoChunk);
+        std::vector<uint32_t> LocalIndex(VertexCount);
+        size_t ChunkVertexCount = 0;
+
+        for (size_t i = 0; i < IndexCount; i += 3)
+        {
+            uint32_t ChunkIndex = static_cast<uint32_t>(Chunks.size()) - 1;
+            size_t NewVertices = 0;
+            for (size_t k = 0; k < 3; k++)
+            {
+                if (Chunks.empty() || VertexChunk[Indices[i + k]] != ChunkIndex) NewVertices++;
+            }
+
+            if (Chunks.empty() || Chunks.back().SourceVertices.size() + NewVertices > MaxChunkVertices)
+            {
+                Chunks.emplace_back();
+                Chunks.back().FirstIndex = static_cast<uint32_t>(i);
+                ChunkIndex = static_cast<uint32_t>(Chunks.size()) - 1;
+            }
+
+            auto& Chunk = Chunks.back();
+            for (size_t k = 0; k < 3; k++)
+            {
+                uint32_t Vertex = Indices[i + k];
+                if (VertexChunk[Vertex] != ChunkIndex)
+                {
+                    VertexChunk[Vertex] = ChunkIndex;
+                    LocalIndex[Vertex] = static_cast<uint32_t>(Chunk.SourceVertices.size());
+                    Chunk.SourceVertices.push_back(Vertex);
+                    ChunkVertexCount++;
+                }
+                Chunk.LocalIndices.push_back(static_cast<uint16_t>(LocalIndex[Vertex]));
+            }
+            Chunk.IndexCount += 3;
+        }
+
+        if (ChunkVertexCount <= VertexCount * MAX_CHUNK_VERTEX_DUPLICATION) return;
+    }
+
+    Chunks.clear();
+    Chunks.emplace_back();
+    Chunks.back().IndexCount = static_cast<uint32_t>(IndexCount);
+    Chunks.back().Is16Bit = false;
+}
+
+//Cuts every meshlet at the draw ranges its triangles fall into and rewrites its vertex list into indices local to the draw range.
+//Draw range i draws the chunk DrawRangeChunks[i] of the level DrawRangeLods[i] of DrawRangeMeshes[i].
+void BuildMeshletCullData(const std::vector<const Mesh*>& DrawRangeMeshes, const std::vector<const MeshLod*>& DrawRangeLods,
+    const std::vector<const IndexChunk*>& DrawRangeChunks, std::vector<MeshletCullData>& Meshlets, std::vector<uint32_t>& MeshletVertices,
+    std::vector<uint32_t>& MeshletTriangles)
+{
+    std::vector<uint32_t> ChunkLocalVertices;
+    for (uint32_t DrawRange = 0; DrawRange < DrawRangeMeshes.size(); DrawRange++)
+    {
+        const Mesh& SrcMesh = *DrawRangeMeshes[DrawRange];
+        const MeshLod& SrcLod = *DrawRangeLods[DrawRange];
+        const IndexChunk& Chunk = *DrawRangeChunks[DrawRange];
+        uint32_t ChunkBegin = Chunk.FirstIndex / 3;
+        uint32_t ChunkEnd = ChunkBegin + Chunk.IndexCount / 3;
+
+        //Vertices of a meshlet that falls partly outside the chunk map to 0, the part kept here never references them
+        if (!Chunk.SourceVertices.empty())
+        {
+            ChunkLocalVertices.assign(SrcMesh.Vertices.size(), 0);
+            for (uint32_t LocalVertex = 0; LocalVertex < Chunk.SourceVertices.size(); LocalVertex++)
+            {
+                ChunkLocalVertices[Chunk.SourceVertices[LocalVertex]] = LocalVertex;
+            }
+        }
+
+        uint32_t MeshletBegin = 0;
+        for (const auto& SrcMeshlet : SrcLod.Meshlets)
+        {
+            uint32_t MeshletEnd = MeshletBegin + SrcMeshlet.TriangleCount;
+            uint32_t Begin = std::max(MeshletBegin, ChunkBegin);
+            uint32_t End = std::min(MeshletEnd, ChunkEnd);
+            if (Begin < End)
+            {
+                MeshletCullData Data;
+                Data.BoundingSphere = SrcMeshlet.BoundingSphere;
+                Data.ConeApex = SrcMeshlet.ConeApex;
+                Data.ConeAxisCutoff = SrcMeshlet.ConeAxisCutoff;
+                Data.LodSphere = SrcMeshlet.LodSphere;
+                Data.ParentLodSphere = SrcMeshlet.ParentLodSphere;
+                Data.LodError = SrcMeshlet.LodError;
+                Data.ParentLodError = SrcMeshlet.ParentLodError;
+                Data.Padding[0] = Data.Padding[1] = 0;
+                Data.DrawRange = DrawRange;
+                Data.VertexOffset = static_cast<uint32_t>(MeshletVertices.size());
+                Data.TriangleOffset = static_cast<uint32_t>(MeshletTriangles.size());
+                Data.TriangleCount = End - Begin;
+                Meshlets.push_back(Data);
+
+                for (uint32_t Vertex = 0; Vertex < SrcMeshlet.VertexCount; Vertex++)
+                {
+                    uint32_t MeshVertex = SrcLod.MeshletVertices[SrcMeshlet.VertexOffset + Vertex];
+                    MeshletVertices.push_back(Chunk.SourceVertices.empty() ? MeshVertex : ChunkLocalVertices[MeshVertex]);
+                }
+                for (uint32_t Triangle = Begin; Triangle < End; Triangle++)
+                {
+                    const uint8_t* Corners = &SrcLod.MeshletTriangles[(SrcMeshlet.TriangleOffset + Triangle - MeshletBegin) * 3];
+                    MeshletTriangles.push_back(uint32_t(Corners[0]) | uint32_t(Corners[1]) << 8 | uint32_t(Corners[2]) << 16);
+                }
+            }
+
+            MeshletBegin = MeshletEnd;
+            if (MeshletBegin >= ChunkEnd) break;
+        }
+    }
+}
+
+//Dequantization parameters mapping the mesh bounds onto the 16-bit unorm range
+DrawData GetPackedDrawData(const glm::vec3& Min, const glm::vec3& Max)
+{
+    DrawData Data;
+    Data.Transform = glm::mat4(1.0f);
+    glm::vec3 Extent = Max - Min;
+    Data.PositionOffset = glm::vec4(Min, 0.0f);
+    Data.PositionScale = glm::vec4(Extent.x > 0.0f ? Extent.x : 1.0f, Extent.y > 0.0f ? Extent.y : 1.0f, Extent.z > 0.0f ? Extent.z : 1.0f, 0.0f);
+    return Data;
+}
+
+//Folds the lower hemisphere over the diagonals of the upper one so a unit vector maps onto [-1, 1]^2
+glm::vec2 EncodeOctahedral(glm::vec3 Normal)
+{
+    float Length = std::abs(Normal.x) + std::abs(Normal.y) + std::abs(Normal.z);
+    if (Length == 0.0f) return glm::vec2(0.0f);
+
+    glm::vec2 Encoded = glm::vec2(Normal) / Length;
+    if (Normal.z < 0.0f)
+    {
+        glm::vec2 Folded = glm::vec2(1.0f - std::abs(Encoded.y), 1.0f - std::abs(Encoded.x));
+        Encoded.x = Encoded.x >= 0.0f ? Folded.x : -Folded.x;
+        Encoded.y = Encoded.y >= 0.0f ? Folded.y : -Folded.y;
+    }
+    return Encoded;
+}
+
+//Packs Count vertices into the two streams, taken through SourceVertices when it is given
+void PackVertices(PackedVertexPosition* Positions, PackedVertexAttributes* Attributes, const Vertex3D* Vertices, const uint32_t* SourceVertices, size_t Count,
+    const DrawData& Quantization)
+{
+    glm::vec3 Offset = glm::vec3(Quantization.PositionOffset);
+    glm::vec3 InverseScale = 1.0f / glm::vec3(Quantization.PositionScale);
+    for (size_t i = 0; i < Count; i++)
+    {
+        const Vertex3D& Vertex = Vertices[SourceVertices != nullptr ? SourceVertices[i] : i];
+
+        uint64_t Position = glm::packUnorm4x16(glm::vec4((Vertex.Position - Offset) * InverseScale, 0.0f));
+        uint32_t UV = glm::packHalf2x16(Vertex.UV);
+        uint32_t Normal = glm::packSnorm2x16(EncodeOctahedral(Vertex.Normal));
+        memcpy(Positions[i].Position, &Position, sizeof(Positions[i].Position));
+        memcpy(Attributes[i].UV, &UV, sizeof(Attributes[i].UV));
+        memcpy(Attributes[i].Normal, &Normal, sizeof(Attributes[i].Normal));
+    }
+}
+
+//Splits Count vertices into the two float streams, taken through SourceVertices when it is given
+void SplitVertices(glm::vec3* Positions, Vertex3DAttributes* Attributes, const Vertex3D* Vertices, const uint32_t* SourceVertices, size_t Count)
+{
+    for (size_t i = 0; i < Count; i++)
+    {
+        const Vertex3D& Vertex = Vertices[SourceVertices != nullptr ? SourceVertices[i] : i];
+        Positions[i] = Vertex.Position;
+        Attributes[i].Color = Vertex.Color;
+        Attributes[i].UV = Vertex.UV;
+        Attributes[i].Normal = Vertex.Normal;
+    }
+}
+
+//Read-only view of a whole file mapped into the address space
+struct MappedFile
+{
+    const char* Data = nullptr;
+    size_t Size = 0;
+#ifdef _WIN32
+    HANDLE FileHandle = INVALID_HANDLE_VALUE;
+    HANDLE MappingHandle = NULL;
+#else
+    int FileDescriptor = -1;
+#endif
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    bool Open(const char* FilePath)
+    {
+        Close();
+#ifdef _WIN32
+        FileHandle = CreateFileA(FilePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (FileHandle == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER FileSize;
+        if (!GetFileSizeEx(FileHandle, &FileSize))
+        {
+            Close();
+            return false;
+        }
+        Size = static_cast<size_t>(FileSize.QuadPart);
+        if (Size == 0) return true;
+
+        MappingHandle = CreateFileMappingA(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (MappingHandle != NULL)
+        {
+            Data = static_cast<const char*>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0));
+        }
+#else
+        FileDescriptor = open(FilePath, O_RDONLY);
+        if (FileDescriptor < 0) return false;
+
+        struct stat FileStatus;
+        if (fstat(FileDescriptor, &FileStatus) != 0)
+        {
+            Close();
+            return false;
+        }
+        Size = static_cast<size_t>(FileStatus.st_size);
+        if (Size == 0) return true;
+
+        void* Mapping = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+        if (Mapping != MAP_FAILED)
+        {
+            Data = static_cast<const char*>(Mapping);
+        }
+#endif
+        if (Data == nullptr)
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+        if (Data != nullptr) UnmapViewOfFile(Data);
+        if (MappingHandle != NULL) CloseHandle(MappingHandle);
+        if (FileHandle != INVALID_HANDLE_VALUE) CloseHandle(FileHandle);
+        MappingHandle = NULL;
+        FileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (Data != nullptr) munmap(const_cast<char*>(Data), Size);
+        if (FileDescriptor >= 0) close(FileDescriptor);
+        FileDescriptor = -1;
+#endif
+        Data = nullptr;
+        Size = 0;
+    }
+};
+
+//Native OBJ import. Assimp's OBJ reader runs on a single thread and allocates per element, this one maps the file, parses line aligned
+//chunks of it in parallel straight into file wide attribute arrays and then assembles the meshes Import3Dmodel would produce out of them.
+const size_t OBJ_CHUNK_SIZE = 4ull * 1024 * 1024;
+const uint32_t OBJ_NO_INDEX = UINT32_MAX;
+
+bool IsObjFile(const char* FilePath)
+{
+    size_t Length = std::strlen(FilePath);
+    return Length >= 4 && FilePath[Length - 4] == '.' && (FilePath[Length - 3] | 0x20) == 'o' && (FilePath[Length - 2] | 0x20) == 'b'
+        && (FilePath[Length - 1] | 0x20) == 'j';
+}
+
+inline bool IsObjBlank(char Character)
+{
+    return Character == ' ' || Character == '\t' || Character == '\r';
+}
+
+inline bool IsObjDigit(char Character)
+{
+    return Character >= '0' && Character <= '9';
+}
+
+inline const char* SkipObjBlanks(const char* Cursor, const char* LineEnd)
+{
+    while (Cursor < LineEnd && IsObjBlank(*Cursor)) Cursor++;
+    return Cursor;
+}
+
+inline bool IsObjKeyword(const char* Line, const char* LineEnd, const char* Keyword)
+{
+    size_t Length = std::strlen(Keyword);
+    return size_t(LineEnd - Line) >= Length && std::memcmp(Line, Keyword, Length) == 0 && (Line + Length == LineEnd || IsObjBlank(Line[Length]));
+}
+
+//Rest of a line without the blanks around it, for material and library names that may contain spaces
+inline std::string GetObjLineArgument(const char* Line, const char* LineEnd, const char* Keyword)
+{
+    const char* Begin = SkipObjBlanks(Line + std::strlen(Keyword), LineEnd);
+    while (LineEnd > Begin && IsObjBlank(LineEnd[-1])) LineEnd--;
+    return std::string(Begin, LineEnd);
+}
+
+//Calls Body with every line of [Begin, End) from its first non blank character on, the line's '\n' is never part of it
+template<typename LineBody>
+void ForEachObjLine(const char* Begin, const char* End, LineBody&& Body)
+{
+    while (Begin < End)
+    {
+        const char* LineEnd = static_cast<const char*>(std::memchr(Begin, '\n', End - Begin));
+        if (LineEnd == nullptr) LineEnd = End;
+        Body(SkipObjBlanks(Begin, LineEnd), LineEnd);
+        Begin = LineEnd + 1;
+    }
+}
+
+//Reads the next number of a line with the parser Assimp's OBJ reader uses, so both readers produce the same bits. Only plain decimals
+//are taken, anything Assimp would throw on, warn about or read as nan or infinity fails so the file goes to Assimp instead.
+bool ParseObjFloat(const char*& Cursor, const char* LineEnd, float& Value)
+{
+    const char* Token = SkipObjBlanks(Cursor, LineEnd);
+    const char* Character = Token;
+    if (Character < LineEnd && (*Character == '-' || *Character == '+')) Character++;
+    size_t IntegerDigits = 0, FractionDigits = 0;
+    for (; Character < LineEnd && IsObjDigit(*Character); Character++) IntegerDigits++;
+    if (Character < LineEnd && *Character == '.')
+    {
+        for (Character++; Character < LineEnd && IsObjDigit(*Character); Character++) FractionDigits++;
+    }
+    if (IntegerDigits + FractionDigits == 0 || IntegerDigits > 18) return false;
+    if (Character < LineEnd && (*Character == 'e' || *Character == 'E'))
+    {
+        Character++;
+        if (Character < LineEnd && (*Character == '-' || *Character == '+')) Character++;
+        size_t ExponentDigits = 0;
+        for (; Character < LineEnd && IsObjDigit(*Character); Character++) ExponentDigits++;
+        if (ExponentDigits == 0 || ExponentDigits > 9) return false;
+    }
+    //Every line ends in a '\n' or, for the file's last one, a terminating zero, so the parser never reads past the token
+    if (Character < LineEnd && !IsObjBlank(*Character)) return false;
+
+    ai_real Parsed;
+    Assimp::fast_atoreal_move<ai_real>(Token, Parsed);
+    Value = static_cast<float>(Parsed);
+    Cursor = Character;
+    return true;
+}
+
+//Plain decimal index, short enough that it can't overflow
+bool ParseObjIndex(const char*& Cursor, const char* LineEnd, int64_t& Index)
+{
+    bool IsNegative = Cursor < LineEnd && *Cursor == '-';
+    if (IsNegative) Cursor++;
+    const char* Digits = Cursor;
+    Index = 0;
+    for (; Cursor < LineEnd && IsObjDigit(*Cursor) && Cursor - Digits < 10; Cursor++)
+    {
+        Index = Index * 10 + (*Cursor - '0');
+    }
+    if (Cursor == Digits || (Cursor < LineEnd && IsObjDigit(*Cursor))) return false;
+    if (IsNegative) Index = -Index;
+    return true;
+}
+
+//OBJ indices count from 1, negative ones back from the last element read before the face
+inline bool ResolveObjIndex(int64_t Index, uint32_t ReadSoFar, uint32_t Total, uint32_t& Resolved)
+{
+    int64_t Value = Index > 0 ? Index - 1 : int64_t(ReadSoFar) + Index;
+    if (Index == 0 || Value < 0 || Value >= int64_t(Total)) return false;
+    Resolved = static_cast<uint32_t>(Value);
+    return true;
+}
+
+struct ObjCorner
+{
+    uint32_t Position;
+    uint32_t UV;
+    uint32_t Normal;
+};
+
+//Faces of one chunk that use the same material, in file order
+struct ObjFaceRun
+{
+    //A run not starting at a usemtl keeps whatever material the file had at that point, an earlier chunk may have set it
+    bool SetsMaterial = false;
+    std::string Material;
+    std::vector<uint32_t> FaceSizes;
+    std::vector<ObjCorner> Corners;
+    //Where the run lands once the runs are sorted into meshes
+    uint32_t MeshIndex = 0;
+    uint32_t FirstVertex = 0;
+    uint32_t FirstIndex = 0;
+};
+
+struct ObjChunk
+{
+    const char* Begin;
+    const char* End;
+    //Attribute lines of the chunk, their prefix sums over the chunks say where the chunk's attributes go in the file wide arrays
+    uint32_t PositionCount = 0;
+    uint32_t UVCount = 0;
+    uint32_t NormalCount = 0;
+    uint32_t FirstPosition = 0;
+    uint32_t FirstUV = 0;
+    uint32_t FirstNormal = 0;
+    std::vector<ObjFaceRun> Runs;
+    std::vector<std::string> MaterialLibraries;
+    bool IsUnsupported = false;
+};
+
+//Triangles of a face the way Assimp's triangulation cuts them: quads fan out of their concave corner, if they have one, anything else
+//fans out of its first corner. Assimp clips ears of polygons with more than four corners, the only case the two readers can differ.
+void TriangulateObjFace(const Vertex3D* Vertices, uint32_t CornerCount, uint32_t FirstVertex, uint32_t* Indices)
+{
+    uint32_t Start = 0;
+    if (CornerCount == 4)
+    {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            const glm::vec3& Corner = Vertices[i].Position;
+            glm::vec3 Left = Vertices[(i + 3) % 4].Position - Corner;
+            glm::vec3 Diagonal = Vertices[(i + 2) % 4].Position - Corner;
+            glm::vec3 Right = Vertices[(i + 1) % 4].Position - Corner;
+            Left /= std::sqrt(glm::dot(Left, Left));
+            Diagonal /= std::sqrt(glm::dot(Diagonal, Diagonal));
+            Right /= std::sqrt(glm::dot(Right, Right));
+            if (std::acos(glm::dot(Left, Diagonal)) + std::acos(glm::dot(Right, Diagonal)) > glm::pi<float>())
+            {
+                Start = i;
+                break;
+            }
+        }
+    }
+    for (uint32_t i = 1; i + 1 < CornerCount; i++)
+    {
+        *Indices++ = FirstVertex + Start;
+        *Indices++ = FirstVertex + (Start + i) % CornerCount;
+        *Indices++ = FirstVertex + (Start + i + 1) % CornerCount;
+    }
+}
+
+//Parses one chunk's lines, the attributes go to the file wide arrays from the chunk's first indices on, the faces into the chunk's runs
+void ParseObjChunk(ObjChunk& Chunk, glm::vec3* Positions, glm::vec2* UVs, glm::vec3* Normals, uint32_t PositionTotal, uint32_t UVTotal, uint32_t NormalTotal)
+{
+    uint32_t PositionIndex = Chunk.FirstPosition, UVIndex = Chunk.FirstUV, NormalIndex = Chunk.FirstNormal;
+    Chunk.Runs.emplace_back();
+    ForEachObjLine(Chunk.Begin, Chunk.End, [&](const char* Line, const char* LineEnd)
+    {
+        if (Chunk.IsUnsupported || Line == LineEnd || *Line == '#') return;
+
+        bool IsUV = IsObjKeyword(Line, LineEnd, "vt"), IsNormal = IsObjKeyword(Line, LineEnd, "vn");
+        if (IsUV || IsNormal || IsObjKeyword(Line, LineEnd, "v"))
+        {
+            //Assimp reads positions with three, four or six components and UVs with two or three, other counts it drops or throws on
+            float Components[6] = {};
+            uint32_t ComponentCount = 0;
+            const char* Cursor = Line + (IsUV || IsNormal ? 2 : 1);
+            while (ComponentCount < 6 && SkipObjBlanks(Cursor, LineEnd) < LineEnd)
+            {
+                if (!ParseObjFloat(Cursor, LineEnd, Components[ComponentCount++]))
+                {
+                    Chunk.IsUnsupported = true;
+                    return;
+                }
+            }
+            bool IsTooLong = SkipObjBlanks(Cursor, LineEnd) < LineEnd;
+            if (IsUV)
+            {
+                Chunk.IsUnsupported = IsTooLong || ComponentCount < 2 || ComponentCount > 3;
+                UVs[UVIndex++] = { Components[0], Components[1] };
+            }
+            else if (IsNormal)
+            {
+                Chunk.IsUnsupported = ComponentCount < 3;
+                Normals[NormalIndex++] = { Components[0], Components[1], Components[2] };
+            }
+            else if (ComponentCount == 4 && Components[3] != 0.0f)
+            {
+                Positions[PositionIndex++] = { Components[0] / Components[3], Components[1] / Components[3], Components[2] / Components[3] };
+            }
+            else
+            {
+                Chunk.IsUnsupported = IsTooLong || (ComponentCount != 3 && ComponentCount != 6);
+                Positions[PositionIndex++] = { Components[0], Components[1], Components[2] };
+            }
+        }
+        else if (IsObjKeyword(Line, LineEnd, "f"))
+        {
+            ObjFaceRun& Run = Chunk.Runs.back();
+            size_t FirstCorner = Run.Corners.size();
+            const char* Cursor = SkipObjBlanks(Line + 1, LineEnd);
+            while (Cursor < LineEnd)
+            {
+                ObjCorner Corner = { OBJ_NO_INDEX, OBJ_NO_INDEX, OBJ_NO_INDEX };
+                int64_t Index;
+                bool IsValid = ParseObjIndex(Cursor, LineEnd, Index) && ResolveObjIndex(Index, PositionIndex, PositionTotal, Corner.Position);
+                if (IsValid && Cursor < LineEnd && *Cursor == '/')
+                {
+                    Cursor++;
+                    if (Cursor < LineEnd && *Cursor != '/')
+                    {
+                        IsValid = ParseObjIndex(Cursor, LineEnd, Index) && ResolveObjIndex(Index, UVIndex, UVTotal, Corner.UV);
+                    }
+                    if (IsValid && Cursor < LineEnd && *Cursor == '/')
+                    {
+                        Cursor++;
+                        IsValid = ParseObjIndex(Cursor, LineEnd, Index) && ResolveObjIndex(Index, NormalIndex, NormalTotal, Corner.Normal);
+                    }
+                }
+                if (!IsValid || (Cursor < LineEnd && !IsObjBlank(*Cursor)))
+                {
+                    Chunk.IsUnsupported = true;
+                    return;
+                }
+                Run.Corners.push_back(Corner);
+                Cursor = SkipObjBlanks(Cursor, LineEnd);
+            }
+            //Faces of one or two corners become point and line meshes in Assimp
+            uint32_t CornerCount = static_cast<uint32_t>(Run.Corners.size() - FirstCorner);
+            Chunk.IsUnsupported = CornerCount < 3;
+            Run.FaceSizes.push_back(CornerCount);
+        }
+        else if (IsObjKeyword(Line, LineEnd, "usemtl"))
+        {
+            if (!Chunk.Runs.back().FaceSizes.empty() || Chunk.Runs.back().SetsMaterial)
+            {
+                Chunk.Runs.emplace_back();
+            }
+            Chunk.Runs.back().SetsMaterial = true;
+            Chunk.Runs.back().Material = GetObjLineArgument(Line, LineEnd, "usemtl");
+        }
+        else if (IsObjKeyword(Line, LineEnd, "mtllib"))
+        {
+            Chunk.MaterialLibraries.push_back(GetObjLineArgument(Line, LineEnd, "mtllib"));
+        }
+        else if (IsObjKeyword(Line, LineEnd, "l") || IsObjKeyword(Line, LineEnd, "p") || IsObjKeyword(Line, LineEnd, "curv")
+            || IsObjKeyword(Line, LineEnd, "surf"))
+        {
+            Chunk.IsUnsupported = true;
+        }
+    });
+}
+
+//Materials in the order Assimp numbers them: its default one, those the material libraries define in the order they define them,
+//then the ones no library defines as the file first uses them. Meshes come out in this order once the pretransform merged them.
+std::map<std::string, uint32_t> GetObjMaterialOrder(const char* FilePath, const std::vector<ObjChunk>& Chunks)
+{
+    std::map<std::string, uint32_t> MaterialOrder;
+    MaterialOrder.emplace(std::string(), 0);
+
+    std::string Directory(FilePath);
+    size_t Separator = Directory.find_last_of("/\\");
+    Directory = Separator == std::string::npos ? std::string() : Directory.substr(0, Separator + 1);
+    for (const ObjChunk& Chunk : Chunks)
+    {
+        for (const std::string& Library : Chunk.MaterialLibraries)
+        {
+            std::ifstream File(Directory + Library);
+            std::string Line;
+            while (std::getline(File, Line))
+            {
+                const char* LineEnd = Line.data() + Line.size();
+                const char* Begin = SkipObjBlanks(Line.data(), LineEnd);
+                if (IsObjKeyword(Begin, LineEnd, "newmtl"))
+                {
+                    MaterialOrder.emplace(GetObjLineArgument(Begin, LineEnd, "newmtl"), static_cast<uint32_t>(MaterialOrder.size()));
+                }
+            }
+        }
+    }
+    return MaterialOrder;
+}
+
+//Imports an OBJ file without Assimp into the meshes Import3Dmodel would make of it. Returns false, leaving DstModel untouched,
+//when the file or the settings need something only Assimp does, such as lines or the node hierarchy.
+bool ImportObjModel(const char* FilePath, Model3D& DstModel, const ImportSettings& Settings)
+{
+    if (Settings.KeepNodeHierarchy) return false;
+
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    MappedFile Source;
+    if (!Source.Open(FilePath) || Source.Size == 0) return false;
+
+    //Line aligned chunks over the mapping, the last line gets copied out with a terminating zero when the file doesn't end in a '\n'
+    //so the float parser can stop on something past every token
+    const char* FileEnd = Source.Data + Source.Size;
+    const char* LastLine = FileEnd;
+    if (FileEnd[-1] != '\n')
+    {
+        while (LastLine > Source.Data && LastLine[-1] != '\n') LastLine--;
+    }
+    std::string LastLineCopy(LastLine, FileEnd);
+    std::vector<ObjChunk> Chunks;
+    for (const char* Begin = Source.Data; Begin < LastLine;)
+    {
+        const char* End = Begin + std::min<size_t>(OBJ_CHUNK_SIZE, LastLine - Begin);
+        const char* LineEnd = static_cast<const char*>(std::memchr(End - 1, '\n', LastLine - (End - 1)));
+        End = LineEnd == nullptr ? LastLine : LineEnd + 1;
+        Chunks.push_back({ Begin, End });
+        Begin = End;
+    }
+    if (!LastLineCopy.empty())
+    {
+        Chunks.push_back({ LastLineCopy.data(), LastLineCopy.data() + LastLineCopy.size() });
+    }
+
+    ParallelFor(Chunks.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t ChunkIndex = Begin; ChunkIndex < End; ChunkIndex++)
+        {
+            ObjChunk& Chunk = Chunks[ChunkIndex];
+            ForEachObjLine(Chunk.Begin, Chunk.End, [&](const char* Line, const char* LineEnd)
+            {
+                Chunk.PositionCount += IsObjKeyword(Line, LineEnd, "v");
+                Chunk.UVCount += IsObjKeyword(Line, LineEnd, "vt");
+                Chunk.NormalCount += IsObjKeyword(Line, LineEnd, "vn");
+            });
+        }
+    });
+
+    uint32_t PositionTotal = 0, UVTotal = 0, NormalTotal = 0;
+    for (ObjChunk& Chunk : Chunks)
+    {
+        Chunk.FirstPosition = PositionTotal;
+        Chunk.FirstUV = UVTotal;
+        Chunk.FirstNormal = NormalTotal;
+        PositionTotal += Chunk.PositionCount;
+        UVTotal += Chunk.UVCount;
+        NormalTotal += Chunk.NormalCount;
+    }
+
+    auto ParseStartTime = std::chrono::high_resolution_clock::now();
+
+    std::vector<glm::vec3> Positions(PositionTotal);
+    std::vector<glm::vec2> UVs(UVTotal);
+    std::vector<glm::vec3> Normals(NormalTotal);
+    ParallelFor(Chunks.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t ChunkIndex = Begin; ChunkIndex < End; ChunkIndex++)
+        {
+            ParseObjChunk(Chunks[ChunkIndex], Positions.data(), UVs.data(), Normals.data(), PositionTotal, UVTotal, NormalTotal);
+        }
+    });
+
+    auto AssemblyStartTime = std::chrono::high_resolution_clock::now();
+
+    for (const ObjChunk& Chunk : Chunks)
+    {
+        if (Chunk.IsUnsupported) return false;
+    }
+
+    //Every material's faces make one mesh, in Assimp's material order and otherwise in file order
+    std::map<std::string, uint32_t> MaterialOrder = GetObjMaterialOrder(FilePath, Chunks);
+    std::vector<ObjFaceRun*> Runs;
+    std::vector<uint32_t> RunMaterials;
+    std::string CurrentMaterial;
+    for (ObjChunk& Chunk : Chunks)
+    {
+        for (ObjFaceRun& Run : Chunk.Runs)
+        {
+            if (Run.SetsMaterial) CurrentMaterial = Run.Material;
+            if (Run.FaceSizes.empty()) continue;
+            Runs.push_back(&Run);
+            RunMaterials.push_back(MaterialOrder.emplace(CurrentMaterial, static_cast<uint32_t>(MaterialOrder.size())).first->second);
+        }
+    }
+    if (Runs.empty()) return false;
+
+    std::vector<uint32_t> MaterialMeshes(MaterialOrder.size(), OBJ_NO_INDEX);
+    for (uint32_t Material : RunMaterials) MaterialMeshes[Material] = 0;
+    uint32_t MeshCount = 0;
+    for (uint32_t& Mesh : MaterialMeshes)
+    {
+        if (Mesh != OBJ_NO_INDEX) Mesh = MeshCount++;
+    }
+
+    size_t FirstMesh = DstModel.Meshes.size();
+    std::vector<size_t> MeshVertexCounts(MeshCount, 0), MeshIndexCounts(MeshCount, 0);
+    for (size_t i = 0; i < Runs.size(); i++)
+    {
+        ObjFaceRun& Run = *Runs[i];
+        Run.MeshIndex = MaterialMeshes[RunMaterials[i]];
+        Run.FirstVertex = static_cast<uint32_t>(MeshVertexCounts[Run.MeshIndex]);
+        Run.FirstIndex = static_cast<uint32_t>(MeshIndexCounts[Run.MeshIndex]);
+        MeshVertexCounts[Run.MeshIndex] += Run.Corners.size();
+        MeshIndexCounts[Run.MeshIndex] += (Run.Corners.size() - 2 * Run.FaceSizes.size()) * 3;
+    }
+
+    DstModel.Meshes.resize(FirstMesh + MeshCount);
+    ParallelFor(MeshCount, 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t i = Begin; i < End; i++)
+        {
+            DstModel.Meshes[FirstMesh + i].Vertices.resize(MeshVertexCounts[i]);
+            DstModel.Meshes[FirstMesh + i].Indices.resize(MeshIndexCounts[i]);
+        }
+    });
+
+    //Like Assimp every face corner gets its own vertex, welding merges them afterwards
+    ParallelFor(Runs.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t RunIndex = Begin; RunIndex < End; RunIndex++)
+        {
+            const ObjFaceRun& Run = *Runs[RunIndex];
+            auto& NewMesh = DstModel.Meshes[FirstMesh + Run.MeshIndex];
+            Vertex3D* Vertices = NewMesh.Vertices.data() + Run.FirstVertex;
+            uint32_t* Indices = NewMesh.Indices.data() + Run.FirstIndex;
+            for (size_t i = 0; i < Run.Corners.size(); i++)
+            {
+                const ObjCorner& Corner = Run.Corners[i];
+                Vertices[i].Position = Positions[Corner.Position];
+                if (Settings.Profile.Normals && Corner.Normal != OBJ_NO_INDEX)
+                {
+                    Vertices[i].Normal = Normals[Corner.Normal];
+                }
+                if (Settings.Profile.UVs && Corner.UV != OBJ_NO_INDEX)
+                {
+                    Vertices[i].UV = UVs[Corner.UV];
+                }
+            }
+
+            uint32_t FaceVertex = Run.FirstVertex;
+            for (uint32_t CornerCount : Run.FaceSizes)
+            {
+                TriangulateObjFace(NewMesh.Vertices.data() + FaceVertex, CornerCount, FaceVertex, Indices);
+                FaceVertex += CornerCount;
+                Indices += (CornerCount - 2) * 3;
+            }
+        }
+    });
+
+    if (!DstModel.Nodes.empty())
+    {
+        AddIdentityNode(static_cast<uint32_t>(FirstMesh), MeshCount, DstModel);
+    }
+
+    auto BoundsStartTime = std::chrono::high_resolution_clock::now();
+    ComputeModelBounds(DstModel);
+
+    auto EndTime = std::chrono::high_resolution_clock::now();
+    std::cout << "Imported " << FilePath << " with the native OBJ reader :: " << MeshCount << " meshes, " << Chunks.size() << " chunks, count "
+        << std::chrono::duration<double, std::milli>(ParseStartTime - StartTime).count() << "ms, parse "
+        << std::chrono::duration<double, std::milli>(AssemblyStartTime - ParseStartTime).count() << "ms, assembly "
+        << std::chrono::duration<double, std::milli>(BoundsStartTime - AssemblyStartTime).count() << "ms, bounds "
+        << std::chrono::duration<double, std::milli>(EndTime - BoundsStartTime).count() << "ms" << std::endl;
+    return true;
+}
+
+//Imports an OBJ file with both readers and prints how long each took and whether they made the same meshes
+void BenchmarkObjImport(const char* FilePath, const ImportSettings& Settings)
+{
+    auto StartTime = std::chrono::high_resolution_clock::now();
+    Model3D AssimpModel;
+    Import3Dmodel(FilePath, AssimpModel, Settings);
+
+    auto NativeStartTime = std::chrono::high_resolution_clock::now();
+    Model3D NativeModel;
+    bool IsNative = ImportObjModel(FilePath, NativeModel, Settings);
+
+    auto EndTime = std::chrono::high_resolution_clock::now();
+    double AssimpMilliseconds = std::chrono::duration<double, std::milli>(NativeStartTime - StartTime).count();
+    double NativeMilliseconds = std::chrono::duration<double, std::milli>(EndTime - NativeStartTime).count();
+    std::cout << "OBJ import benchmark " << FilePath << " :: Assimp " << AssimpMilliseconds << "ms, native " << NativeMilliseconds << "ms";
+    if (!IsNative)
+    {
+        std::cout << ", the native reader left the file to Assimp" << std::endl;
+        return;
+    }
+
+    size_t FirstDifference = AssimpModel.Meshes.size() == NativeModel.Meshes.size() ? SIZE_MAX : 0;
+    for (size_t i = 0; i < AssimpModel.Meshes.size() && FirstDifference == SIZE_MAX; i++)
+    {
+        const Mesh& AssimpMesh = AssimpModel.Meshes[i];
+        const Mesh& NativeMesh = NativeModel.Meshes[i];
+        bool IsSame = AssimpMesh.Vertices.size() == NativeMesh.Vertices.size() && AssimpMesh.Indices == NativeMesh.Indices
+            && std::memcmp(AssimpMesh.Vertices.data(), NativeMesh.Vertices.data(), AssimpMesh.Vertices.size() * sizeof(Vertex3D)) == 0;
+        if (!IsSame) FirstDifference = i;
+    }
+    std::cout << " (" << AssimpMilliseconds / std::max(NativeMilliseconds, 1e-3) << "x), ";
+    if (FirstDifference == SIZE_MAX)
+    {
+        std::cout << "identical output" << std::endl;
+    }
+    else
+    {
+        std::cout << "output differs from mesh " << FirstDifference << " on" << std::endl;
+    }
+}
+
+//Cooked model layout: header, one entry per mesh, one entry per draw level of every mesh in mesh order, the scene nodes and the meshes they place,
+//then the raw vertex, index and meshlet arrays each aligned to 16 bytes
+struct CookedModelHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t SourceHash;
+    uint32_t MeshCount;
+    uint32_t VertexStride;
+    uint32_t NodeCount;
+    uint32_t NodeMeshCount;
+    Bounds3D Bounds;
+};
+
+struct CookedMeshEntry
+{
+    uint64_t VertexDataOffset;
+    uint32_t VertexCount;
+    //The mesh's levels follow those of the previous meshes, the full detail one first and the cluster DAG, if any, last
+    uint32_t LodCount;
+    uint32_t HasClusterDag;
+    uint32_t Padding;
+    Bounds3D Bounds;
+};
+
+struct CookedLodEntry
+{
+    uint64_t IndexDataOffset;
+    uint64_t MeshletDataOffset;
+    uint64_t MeshletVertexDataOffset;
+    uint64_t MeshletTriangleDataOffset;
+    uint32_t IndexCount;
+    uint32_t MeshletCount;
+    uint32_t MeshletVertexCount;
+    uint32_t MeshletTriangleCount;
+    float Error;
+    uint32_t Padding;
+};
+
+inline uint64_t AlignCookedOffset(uint64_t Offset)
+{
+    return (Offset + 15) & ~15ull;
+}
+
+std::string GetCookedModelPath(const char* FilePath)
+{
+    return std::string(FilePath) + ".cooked";
+}
+
+//Visits a mesh's arrays in the order the cooked file and the arena lay them out: the vertices, then the indices, meshlets, meshlet vertices
+//and meshlet triangles of every draw level
+template<typename MeshType, typename Visitor>
+void ForEachMeshArray(MeshType& SrcMesh, Visitor&& Visit)
+{
+    Visit(SrcMesh.Vertices);
+    for (uint32_t Level = 0; Level < SrcMesh.GetDrawLevelCount(); Level++)
+    {
+        auto& Lod = SrcMesh.GetDrawLevel(Level);
+        Visit(Lod.Indices);
+        Visit(Lod.Meshlets);
+        Visit(Lod.MeshletVertices);
+        Visit(Lod.MeshletTriangles);
+    }
+}
+
+//Moves a freshly built model's arrays into one arena laid out like the cooked file, the heap arrays of the build steps go away
+void PackModelArena(Model3D& DstModel)
+{
+    size_t LodBytes = 0, DataBytes = 0;
+    for (const auto& Mesh : DstModel.Meshes)
+    {
+        LodBytes = AlignGeometryArenaOffset(LodBytes) + sizeof(MeshLod) * Mesh.Lods.size();
+        ForEachMeshArray(Mesh, [&](const auto& Array)
+        {
+            DataBytes = AlignGeometryArenaOffset(DataBytes) + sizeof(Array[0]) * Array.size();
+        });
+    }
+
+    auto Arena = std::make_unique<GeometryArena>(AlignGeometryArenaOffset(LodBytes) + DataBytes);
+    GeometryArena* ArenaPointer = Arena.get();
+    for (auto& Mesh : DstModel.Meshes)
+    {
+        Mesh.Lods = GeometryArray<MeshLod>(std::make_move_iterator(Mesh.Lods.begin()), std::make_move_iterator(Mesh.Lods.end()),
+            ArenaAllocator<MeshLod>(ArenaPointer));
+    }
+    Arena->DataOffset = AlignGeometryArenaOffset(Arena->Used);
+    for (auto& Mesh : DstModel.Meshes)
+    {
+        ForEachMeshArray(Mesh, [&](auto& Array)
+        {
+            typedef typename std::decay_t<decltype(Array)>::value_type ElementType;
+            Array = GeometryArray<ElementType>(Array.begin(), Array.end(), ArenaAllocator<ElementType>(ArenaPointer));
+        });
+    }
+    DstModel.Arena = std::move(Arena);
+}
+
+//A corrupt cache can still carry the right hash, every value the renderer indexes with is checked before it is trusted
+bool IsCookedLodValid(const MeshLod& Lod, size_t VertexCount)
+{
+    if (Lod.Indices.size() % 3 != 0 || Lod.MeshletTriangles.size() % 3 != 0) return false;
+    for (uint32_t Index : Lod.Indices)
+    {
+        if (Index >= VertexCount) return false;
+    }
+    for (uint32_t Vertex : Lod.MeshletVertices)
+    {
+        if (Vertex >= VertexCount) return false;
+    }
+
+    uint64_t MeshletTriangleTotal = 0;
+    for (const Meshlet& SrcMeshlet : Lod.Meshlets)
+    {
+        if (uint64_t(SrcMeshlet.VertexOffset) + SrcMeshlet.VertexCount > Lod.MeshletVertices.size() ||
+            3 * (uint64_t(SrcMeshlet.TriangleOffset) + SrcMeshlet.TriangleCount) > Lod.MeshletTriangles.size())
+        {
+            return false;
+        }
+        const uint8_t* Triangles = Lod.MeshletTriangles.data() + 3 * size_t(SrcMeshlet.TriangleOffset);
+        for (size_t i = 0; i < 3 * size_t(SrcMeshlet.TriangleCount); i++)
+        {
+            if (Triangles[i] >= SrcMeshlet.VertexCount) return false;
+        }
+        MeshletTriangleTotal += SrcMeshlet.TriangleCount;
+    }
+    return MeshletTriangleTotal <= Lod.Indices.size() / 3;
+}
+
+//Returns false when the cache is missing, from an older version, cooked from different source contents or corrupt
+bool LoadCookedModel(const char* CachePath, uint64_t SourceHash, Model3D& DstModel)
+{
+    MappedFile Cache;
+    if (!Cache.Open(CachePath) || Cache.Size < sizeof(CookedModelHeader)) return false;
+
+    CookedModelHeader Header;
+    memcpy(&Header, Cache.Data, sizeof(Header));
+    if (Header.Magic != COOKED_MODEL_MAGIC || Header.Version != COOKED_MODEL_VERSION ||
+        Header.SourceHash != SourceHash || Header.VertexStride != sizeof(Vertex3D))
+    {
+        return false;
+    }
+
+    uint64_t EntriesEnd = sizeof(CookedModelHeader) + sizeof(CookedMeshEntry) * uint64_t(Header.MeshCount);
+    if (EntriesEnd > Cache.Size) return false;
+    //Written so that huge offsets can't wrap around
+    auto IsInFile = [&Cache](uint64_t Offset, uint64_t Size)
+    {
+        return Offset <= Cache.Size && Size <= Cache.Size - Offset;
+    };
+
+    const CookedMeshEntry* Entries = reinterpret_cast<const CookedMeshEntry*>(Cache.Data + sizeof(CookedModelHeader));
+    uint64_t LodEntryCount = 0;
+    uint64_t DataBegin = Header.MeshCount > 0 ? Entries[0].VertexDataOffset : 0, DataEnd = DataBegin;
+    size_t LodBytes = 0;
+    for (uint32_t MeshIndex = 0; MeshIndex < Header.MeshCount; MeshIndex++)
+    {
+        const CookedMeshEntry& Entry = Entries[MeshIndex];
+        if (Entry.LodCount == 0 || Entry.VertexDataOffset < DataBegin || !IsInFile(Entry.VertexDataOffset, sizeof(Vertex3D) * uint64_t(Entry.VertexCount)))
+        {
+            return false;
+        }
+        LodEntryCount += uint64_t(Entry.LodCount) + (Entry.HasClusterDag ? 1 : 0);
+        LodBytes = AlignGeometryArenaOffset(LodBytes) + sizeof(MeshLod) * (Entry.LodCount - 1);
+        DataEnd = std::max<uint64_t>(DataEnd, Entry.VertexDataOffset + sizeof(Vertex3D) * uint64_t(Entry.VertexCount));
+    }
+    uint64_t NodesBegin = EntriesEnd + sizeof(CookedLodEntry) * LodEntryCount;
+    uint64_t NodeMeshesBegin = NodesBegin + sizeof(SceneNode) * uint64_t(Header.NodeCount);
+    if (NodeMeshesBegin + sizeof(uint32_t) * uint64_t(Header.NodeMeshCount) > Cache.Size) return false;
+
+    const CookedLodEntry* LodEntries = reinterpret_cast<const CookedLodEntry*>(Cache.Data + EntriesEnd);
+    for (uint64_t LodIndex = 0; LodIndex < LodEntryCount; LodIndex++)
+    {
+        const CookedLodEntry& Entry = LodEntries[LodIndex];
+        uint64_t IndexEnd = Entry.IndexDataOffset + sizeof(uint32_t) * uint64_t(Entry.IndexCount);
+        uint64_t MeshletEnd = Entry.MeshletDataOffset + sizeof(Meshlet) * uint64_t(Entry.MeshletCount);
+        uint64_t MeshletVertexEnd = Entry.MeshletVertexDataOffset + sizeof(uint32_t) * uint64_t(Entry.MeshletVertexCount);
+        uint64_t MeshletTriangleEnd = Entry.MeshletTriangleDataOffset + 3 * uint64_t(Entry.MeshletTriangleCount);
+        if (!IsInFile(Entry.IndexDataOffset, sizeof(uint32_t) * uint64_t(Entry.IndexCount)) || !IsInFile(Entry.MeshletDataOffset, sizeof(Meshlet) * uint64_t(Entry.MeshletCount)) ||
+            !IsInFile(Entry.MeshletVertexDataOffset, sizeof(uint32_t) * uint64_t(Entry.MeshletVertexCount)) ||
+            !IsInFile(Entry.MeshletTriangleDataOffset, 3 * uint64_t(Entry.MeshletTriangleCount)) ||
+            std::min({ Entry.IndexDataOffset, Entry.MeshletDataOffset, Entry.MeshletVertexDataOffset, Entry.MeshletTriangleDataOffset }) < DataBegin)
+        {
+            return false;
+        }
+        DataEnd = std::max({ DataEnd, IndexEnd, MeshletEnd, MeshletVertexEnd, MeshletTriangleEnd });
+    }
+
+    DstModel.Nodes.resize(Header.NodeCount);
+    DstModel.NodeMeshes.resize(Header.NodeMeshCount);
+    memcpy(DstModel.Nodes.data(), Cache.Data + NodesBegin, sizeof(SceneNode) * Header.NodeCount);
+    memcpy(DstModel.NodeMeshes.data(), Cache.Data + NodeMeshesBegin, sizeof(uint32_t) * Header.NodeMeshCount);
+    for (uint32_t NodeIndex = 0; NodeIndex < Header.NodeCount; NodeIndex++)
+    {
+        const SceneNode& Node = DstModel.Nodes[NodeIndex];
+        if (Node.Parent < -1 || Node.Parent >= int32_t(NodeIndex) || uint64_t(Node.FirstMesh) + Node.MeshCount > Header.NodeMeshCount) return false;
+    }
+    for (uint32_t MeshIndex : DstModel.NodeMeshes)
+    {
+        if (MeshIndex >= Header.MeshCount) return false;
+    }
+
+    //The arrays are bumped off the model's arena in the file's order so they land at the file's offsets, the data then comes over in one copy
+    DstModel.Meshes.clear();
+    DstModel.Arena = std::make_unique<GeometryArena>(AlignGeometryArenaOffset(LodBytes) + (DataEnd - DataBegin));
+    GeometryArena* Arena = DstModel.Arena.get();
+    DstModel.Meshes.resize(Header.MeshCount);
+    DstModel.Bounds = Header.Bounds;
+    for (uint32_t MeshIndex = 0; MeshIndex < Header.MeshCount; MeshIndex++)
+    {
+        DstModel.Meshes[MeshIndex].Lods = GeometryArray<MeshLod>(Entries[MeshIndex].LodCount - 1, ArenaAllocator<MeshLod>(Arena));
+    }
+    Arena->DataOffset = AlignGeometryArenaOffset(Arena->Used);
+
+    struct ArrayCopy
+    {
+        void* Destination;
+        uint64_t SourceOffset;
+        size_t Size;
+    };
+    std::vector<ArrayCopy> Copies;
+    bool IsInPlace = true;
+    auto PlaceArray = [&](auto& Array, size_t Count, uint64_t SourceOffset)
+    {
+        typedef typename std::decay_t<decltype(Array)>::value_type ElementType;
+        Array = GeometryArray<ElementType>(Count, ArenaAllocator<ElementType>(Arena));
+        if (Count == 0) return;
+        Copies.push_back({ Array.data(), SourceOffset, sizeof(ElementType) * Count });
+        IsInPlace &= reinterpret_cast<uint8_t*>(Array.data()) == Arena->Base + Arena->DataOffset + (SourceOffset - DataBegin);
+    };
+    for (uint32_t MeshIndex = 0; MeshIndex < Header.MeshCount; MeshIndex++)
+    {
+        const CookedMeshEntry& Entry = Entries[MeshIndex];
+        auto& Mesh = DstModel.Meshes[MeshIndex];
+        Mesh.Bounds = Entry.Bounds;
+        PlaceArray(Mesh.Vertices, Entry.VertexCount, Entry.VertexDataOffset);
+        for (uint32_t Level = 0; Level < Entry.LodCount + (Entry.HasClusterDag ? 1 : 0); Level++)
+        {
+            const CookedLodEntry& LodEntry = *LodEntries++;
+            auto& Lod = Mesh.GetDrawLevel(Level);
+            Lod.Error = LodEntry.Error;
+            PlaceArray(Lod.Indices, LodEntry.IndexCount, LodEntry.IndexDataOffset);
+            PlaceArray(Lod.Meshlets, LodEntry.MeshletCount, LodEntry.MeshletDataOffset);
+            PlaceArray(Lod.MeshletVertices, LodEntry.MeshletVertexCount, LodEntry.MeshletVertexDataOffset);
+            PlaceArray(Lod.MeshletTriangles, 3 * size_t(LodEntry.MeshletTriangleCount), LodEntry.MeshletTriangleDataOffset);
+        }
+    }
+
+    //Arrays only fall out of place when the arena ran full, they are then copied one by one
+    if (IsInPlace)
+    {
+        memcpy(Arena->Base + Arena->DataOffset, Cache.Data + DataBegin, DataEnd - DataBegin);
+    }
+    else
+    {
+        for (const ArrayCopy& Copy : Copies)
+        {
+            memcpy(Copy.Destination, Cache.Data + Copy.SourceOffset, Copy.Size);
+        }
+    }
+
+    for (const auto& Mesh : DstModel.Meshes)
+    {
+        for (uint32_t Level = 0; Level < Mesh.GetDrawLevelCount(); Level++)
+        {
+            if (!IsCookedLodValid(Mesh.GetDrawLevel(Level), Mesh.Vertices.size())) return false;
+        }
+    }
+    return true;
+}
+
+void WriteCookedModel(const char* CachePath, uint64_t SourceHash, const Model3D& SrcModel)
+{
+    CookedModelHeader Header{};
+    Header.Magic = COOKED_MODEL_MAGIC;
+    Header.Version = COOKED_MODEL_VERSION;
+    Header.SourceHash = SourceHash;
+    Header.MeshCount = static_cast<uint32_t>(SrcModel.Meshes.size());
+    Header.VertexStride = sizeof(Vertex3D);
+    Header.NodeCount = static_cast<uint32_t>(SrcModel.Nodes.size());
+    Header.NodeMeshCount = static_cast<uint32_t>(SrcModel.NodeMeshes.size());
+    Header.Bounds = SrcModel.Bounds;
+
+    std::vector<CookedMeshEntry> Entries(SrcModel.Meshes.size());
+    std::vector<CookedLodEntry> LodEntries;
+    for (auto& Mesh : SrcModel.Meshes)
+    {
+        LodEntries.resize(LodEntries.size() + Mesh.GetDrawLevelCount());
+    }
+
+    uint64_t Offset = sizeof(CookedModelHeader) + sizeof(CookedMeshEntry) * Entries.size() + sizeof(CookedLodEntry) * LodEntries.size() +
+        sizeof(SceneNode) * SrcModel.Nodes.size() + sizeof(uint32_t) * SrcModel.NodeMeshes.size();
+    uint64_t DataBegin = AlignCookedOffset(Offset);
+
+    //A packed model's arrays already sit in its arena the way the file lays them out, its data then goes out in one write
+    const uint8_t* ArenaData = SrcModel.Arena ? SrcModel.Arena->Base + SrcModel.Arena->DataOffset : nullptr;
+    bool IsInPlace = ArenaData != nullptr;
+    auto CheckInPlace = [&](const auto& Array, uint64_t DataOffset)
+    {
+        IsInPlace &= Array.empty() || reinterpret_cast<const uint8_t*>(Array.data()) == ArenaData + (DataOffset - DataBegin);
+    };
+
+    size_t LodIndex = 0;
+    for (size_t MeshIndex = 0; MeshIndex < SrcModel.Meshes.size(); MeshIndex++)
+    {
+        auto& Mesh = SrcModel.Meshes[MeshIndex];
+        auto& Entry = Entries[MeshIndex];
+        Entry.VertexCount = static_cast<uint32_t>(Mesh.Vertices.size());
+        Entry.LodCount = Mesh.GetLodCount();
+        Entry.HasClusterDag = Mesh.GetDrawLevelCount() > Mesh.GetLodCount() ? 1 : 0;
+        Entry.Padding = 0;
+        Entry.Bounds = Mesh.Bounds;
+        Entry.VertexDataOffset = Offset = AlignCookedOffset(Offset);
+        Offset += sizeof(Vertex3D) * Mesh.Vertices.size();
+        CheckInPlace(Mesh.Vertices, Entry.VertexDataOffset);
+
+        for (uint32_t Level = 0; Level < Mesh.GetDrawLevelCount(); Level++)
+        {
+            auto& Lod = Mesh.GetDrawLevel(Level);
+            auto& LodEntry = LodEntries[LodIndex++];
+            LodEntry.Error = Lod.Error;
+            LodEntry.Padding = 0;
+            LodEntry.IndexCount = static_cast<uint32_t>(Lod.Indices.size());
+            LodEntry.IndexDataOffset = Offset = AlignCookedOffset(Offset);
+            Offset += sizeof(uint32_t) * Lod.Indices.size();
+
+            LodEntry.MeshletCount = static_cast<uint32_t>(Lod.Meshlets.size());
+            LodEntry.MeshletVertexCount = static_cast<uint32_t>(Lod.MeshletVertices.size());
+            LodEntry.MeshletTriangleCount = static_cast<uint32_t>(Lod.MeshletTriangles.size() / 3);
+            LodEntry.MeshletDataOffset = Offset = AlignCookedOffset(Offset);
+            Offset += sizeof(Meshlet) * Lod.Meshlets.size();
+            LodEntry.MeshletVertexDataOffset = Offset = AlignCookedOffset(Offset);
+            Offset += sizeof(uint32_t) * Lod.MeshletVertices.size();
+            LodEntry.MeshletTriangleDataOffset = Offset = AlignCookedOffset(Offset);
+            Offset += Lod.MeshletTriangles.size();
+
+            CheckInPlace(Lod.Indices, LodEntry.IndexDataOffset);
+            CheckInPlace(Lod.Meshlets, LodEntry.MeshletDataOffset);
+            CheckInPlace(Lod.MeshletVertices, LodEntry.MeshletVertexDataOffset);
+            CheckInPlace(Lod.MeshletTriangles, LodEntry.MeshletTriangleDataOffset);
+        }
+    }
+
+    //Written to a temporary file first so an interrupted write never leaves a cache that looks valid
+    std::string TemporaryPath = std::string(CachePath) + ".tmp";
+    std::ofstream File(TemporaryPath, std::ios::binary | std::ios::trunc);
+    if (!File.is_open())
+    {
+        std::cout << "Unable to write the cooked model " << CachePath << std::endl;
+        return;
+    }
+
+    const char Padding[16] = {};
+    uint64_t Written = 0;
+    auto Write = [&](const void* Data, uint64_t Size)
+    {
+        File.write(static_cast<const char*>(Data), Size);
+        Written += Size;
+    };
+    auto PadTo = [&](uint64_t Target)
+    {
+        Write(Padding, Target - Written);
+    };
+
+    Write(&Header, sizeof(Header));
+    Write(Entries.data(), sizeof(CookedMeshEntry) * Entries.size());
+    Write(LodEntries.data(), sizeof(CookedLodEntry) * LodEntries.size());
+    Write(SrcModel.Nodes.data(), sizeof(SceneNode) * SrcModel.Nodes.size());
+    Write(SrcModel.NodeMeshes.data(), sizeof(uint32_t) * SrcModel.NodeMeshes.size());
+    if (IsInPlace)
+    {
+        PadTo(DataBegin);
+        Write(ArenaData, Offset - DataBegin);
+    }
+    LodIndex = 0;
+    for (size_t MeshIndex = 0; MeshIndex < SrcModel.Meshes.size() && !IsInPlace; MeshIndex++)
+    {
+        auto& Mesh = SrcModel.Meshes[MeshIndex];
+        PadTo(Entries[MeshIndex].VertexDataOffset);
+        Write(Mesh.Vertices.data(), sizeof(Vertex3D) * Mesh.Vertices.size());
+        for (uint32_t Level = 0; Level < Mesh.GetDrawLevelCount(); Level++)
+        {
+            auto& Lod = Mesh.GetDrawLevel(Level);
+            auto& LodEntry = LodEntries[LodIndex++];
+            PadTo(LodEntry.IndexDataOffset);
+            Write(Lod.Indices.data(), sizeof(uint32_t) * Lod.Indices.size());
+            PadTo(LodEntry.MeshletDataOffset);
+            Write(Lod.Meshlets.data(), sizeof(Meshlet) * Lod.Meshlets.size());
+            PadTo(LodEntry.MeshletVertexDataOffset);
+            Write(Lod.MeshletVertices.data(), sizeof(uint32_t) * Lod.MeshletVertices.size());
+            PadTo(LodEntry.MeshletTriangleDataOffset);
+            Write(Lod.MeshletTriangles.data(), Lod.MeshletTriangles.size());
+        }
+    }
+    File.close();
+
+    if (!File)
+    {
+        std::remove(TemporaryPath.c_str());
+        std::cout << "Unable to write the cooked model " << CachePath << std::endl;
+        return;
+    }
+    std::remove(CachePath);
+    std::rename(TemporaryPath.c_str(), CachePath);
+}
+
+uint64_t HashImportSettings(const ImportSettings& Settings, uint64_t Hash)
+{
+    Hash = HashBytes(&MODEL_IMPORT_BASE_FLAGS, sizeof(MODEL_IMPORT_BASE_FLAGS), Hash);
+    Hash = HashBytes(&Settings.Profile.Normals, sizeof(Settings.Profile.Normals), Hash);
+    Hash = HashBytes(&Settings.Profile.UVs, sizeof(Settings.Profile.UVs), Hash);
+    Hash = HashBytes(&Settings.WeldVertices, sizeof(Settings.WeldVertices), Hash);
+    Hash = HashBytes(&Settings.OptimizeVertexOrder, sizeof(Settings.OptimizeVertexOrder), Hash);
+    Hash = HashBytes(&Settings.OverdrawThreshold, sizeof(Settings.OverdrawThreshold), Hash);
+    Hash = HashBytes(&Settings.LodCount, sizeof(Settings.LodCount), Hash);
+    Hash = HashBytes(&Settings.LodReduction, sizeof(Settings.LodReduction), Hash);
+    Hash = HashBytes(&Settings.LodMaxError, sizeof(Settings.LodMaxError), Hash);
+    Hash = HashBytes(&Settings.BuildMeshlets, sizeof(Settings.BuildMeshlets), Hash);
+    Hash = HashBytes(&Settings.ClusterDagMinTriangles, sizeof(Settings.ClusterDagMinTriangles), Hash);
+    Hash = HashBytes(&Settings.KeepNodeHierarchy, sizeof(Settings.KeepNodeHierarchy), Hash);
+    Hash = HashBytes(&Settings.NativeObjImport, sizeof(Settings.NativeObjImport), Hash);
+    Hash = HashBytes(&Settings.NormalCreaseAngle, sizeof(Settings.NormalCreaseAngle), Hash);
+    return Hash;
+}
+
+//Loads the cooked copy of a model when it was built from the same file contents and import settings, otherwise imports and cooks it
+void LoadModel(const char* FilePath, const ImportSettings& Settings, Model3D& DstModel)
+{
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    uint64_t SourceHash;
+    {
+        MappedFile Source;
+        if (!Source.Open(FilePath))
+        {
+            throw std::runtime_error("Unable to open a 3D model(" + std::string(FilePath) + ")");
+        }
+        SourceHash = HashImportSettings(Settings, HashBytes(Source.Data, Source.Size));
+    }
+
+    std::string CachePath = GetCookedModelPath(FilePath);
+    bool IsCacheHit = LoadCookedModel(CachePath.c_str(), SourceHash, DstModel);
+    if (!IsCacheHit)
+    {
+        DstModel.Meshes.clear();
+        DstModel.Nodes.clear();
+        DstModel.NodeMeshes.clear();
+        if (Settings.BenchmarkObjImport && IsObjFile(FilePath))
+        {
+            BenchmarkObjImport(FilePath, Settings);
+        }
+        if (!Settings.NativeObjImport || !IsObjFile(FilePath) || !ImportObjModel(FilePath, DstModel, Settings))
+        {
+            Import3Dmodel(FilePath, DstModel, Settings);
+        }
+        if (Settings.Profile.Normals)
+        {
+            GenerateModelNormals(DstModel, Settings);
+        }
+        if (Settings.WeldVertices)
+        {
+            WeldModel(DstModel);
+        }
+        if (Settings.OptimizeVertexOrder)
+        {
+            OptimizeModel(DstModel, Settings);
+        }
+        if (Settings.LodCount > 0)
+        {
+            BuildModelLods(DstModel, Settings);
+        }
+        if (Settings.BuildMeshlets)
+        {
+            BuildModelMeshlets(DstModel);
+        }
+        if (Settings.BuildMeshlets && Settings.ClusterDagMinTriangles > 0)
+        {
+            BuildModelClusterDags(DstModel, Settings);
+        }
+        PackModelArena(DstModel);
+        WriteCookedModel(CachePath.c_str(), SourceHash, DstModel);
+    }
+    DstModel.Format = Settings.Format;
+
+    double Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count();
+    std::cout << (IsCacheHit ? "Loaded cooked model " : "Imported and cooked model ") << FilePath << " :: " << Milliseconds << "ms" << std::endl;
+}
+
+//Levels of a full mip chain, down to and including the 1x1 one
+uint32_t GetMipLevelCount(uint32_t Width, uint32_t Height)
+{
+    uint32_t LevelCount = 1;
+    for (uint32_t Extent = std::max(Width, Height); Extent > 1; Extent >>= 1)
+    {
+        LevelCount++;
+    }
+    return LevelCount;
+}
+
+uint32_t GetMipExtent(uint32_t Extent, uint32_t Level)
+{
+    return std::max(1u, Extent >> Level);
+}
+
+//Linear light value of every 8 bit sRGB value
+const std::array<float, 256>& GetSrgbToLinearTable()
+{
+    static const std::array<float, 256> Table = []()
+    {
+        std::array<float, 256> Values;
+        for (int i = 0; i < 256; i++)
+        {
+            float Srgb = i / 255.0f;
+            Values[i] = Srgb <= 0.04045f ? Srgb / 12.92f : std::pow((Srgb + 0.055f) / 1.055f, 2.4f);
+        }
+        return Values;
+    }();
+    return Table;
+}
+
+//Linear values halfway between two neighbouring sRGB values, the number of them below a value is its closest 8 bit sRGB encoding
+const std::array<float, 255>& GetLinearToSrgbThresholds()
+{
+    static const std::array<float, 255> Table = []()
+    {
+        std::array<float, 255> Values;
+        for (int i = 0; i < 255; i++)
+        {
+            float Srgb = (i + 0.5f) / 255.0f;
+            Values[i] = Srgb <= 0.04045f ? Srgb / 12.92f : std::pow((Srgb + 0.055f) / 1.055f, 2.4f);
+        }
+        return Values;
+    }();
+    return Table;
+}
+
+//2x2 box filter, the last row or column is repeated when the source extent is odd
+void DownsampleMipLevel(const glm::vec4* Src, uint32_t SrcWidth, uint32_t SrcHeight, glm::vec4* Dst, uint32_t DstWidth, uint32_t DstHeight)
+{
+    ParallelFor(DstHeight, 64, [&](size_t Begin, size_t End)
+    {
+        for (size_t Y = Begin; Y < End; Y++)
+        {
+            const glm::vec4* Row0 = Src + std::min<size_t>(Y * 2, SrcHeight - 1) * SrcWidth;
+            const glm::vec4* Row1 = Src + std::min<size_t>(Y * 2 + 1, SrcHeight - 1) * SrcWidth;
+            glm::vec4* DstRow = Dst + Y * DstWidth;
+            for (size_t X = 0; X < DstWidth; X++)
+            {
+                size_t X0 = std::min<size_t>(X * 2, SrcWidth - 1), X1 = std::min<size_t>(X * 2 + 1, SrcWidth - 1);
+#ifdef USE_SSE2
+                //A texel's four channels fill one register
+                __m128 Top = _mm_add_ps(_mm_loadu_ps(&Row0[X0].x), _mm_loadu_ps(&Row0[X1].x));
+                __m128 Bottom = _mm_add_ps(_mm_loadu_ps(&Row1[X0].x), _mm_loadu_ps(&Row1[X1].x));
+                _mm_storeu_ps(&DstRow[X].x, _mm_mul_ps(_mm_add_ps(Top, Bottom), _mm_set1_ps(0.25f)));
+#else
+                DstRow[X] = (Row0[X0] + Row0[X1] + Row1[X0] + Row1[X1]) * 0.25f;
+#endif
+            }
+        }
+    });
+}
+
+//CPU fallback for formats the GPU can't blit with linear filtering. Every level of an 8 bit sRGB RGBA image is filtered in linear light from
+//the one above it and stored after it in DstChain, LevelOffsets gets where each level starts.
+void BuildSrgbMipChain(const uint8_t* Pixels, uint32_t Width, uint32_t Height, uint32_t LevelCount, std::vector<uint8_t>& DstChain, std::vector<size_t>& LevelOffsets)
+{
+    const auto& ToLinear = GetSrgbToLinearTable();
+    const auto& Thresholds = GetLinearToSrgbThresholds();
+
+    LevelOffsets.resize(LevelCount);
+    size_t ChainSize = 0;
+    for (uint32_t Level = 0; Level < LevelCount; Level++)
+    {
+        LevelOffsets[Level] = ChainSize;
+        ChainSize += size_t(GetMipExtent(Width, Level)) * GetMipExtent(Height, Level) * 4;
+    }
+    DstChain.resize(ChainSize);
+    memcpy(DstChain.data(), Pixels, size_t(Width) * Height * 4);
+
+    std::vector<glm::vec4> Current(size_t(Width) * Height);
+    ParallelFor(Current.size(), 1 << 16, [&](size_t Begin, size_t End)
+    {
+        for (size_t Texel = Begin; Texel < End; Texel++)
+        {
+            const uint8_t* Src = Pixels + Texel * 4;
+            Current[Texel] = glm::vec4(ToLinear[Src[0]], ToLinear[Src[1]], ToLinear[Src[2]], Src[3] / 255.0f);
+        }
+    });
+
+    std::vector<glm::vec4> Next;
+    for (uint32_t Level = 1; Level < LevelCount; Level++)
+    {
+        uint32_t SrcWidth = GetMipExtent(Width, Level - 1), SrcHeight = GetMipExtent(Height, Level - 1);
+        uint32_t DstWidth = GetMipExtent(Width, Level), DstHeight = GetMipExtent(Height, Level);
+        Next.resize(size_t(DstWidth) * DstHeight);
+        DownsampleMipLevel(Current.data(), SrcWidth, SrcHeight, Next.data(), DstWidth, DstHeight);
+
+        uint8_t* Dst = DstChain.data() + LevelOffsets[Level];
+        ParallelFor(Next.size(), 1 << 14, [&](size_t Begin, size_t End)
+        {
+            for (size_t Texel = Begin; Texel < End; Texel++)
+            {
+                const glm::vec4& Color = Next[Texel];
+                for (int Channel = 0; Channel < 3; Channel++)
+                {
+                    Dst[Texel * 4 + Channel] = uint8_t(std::upper_bound(Thresholds.begin(), Thresholds.end(), Color[Channel]) - Thresholds.begin());
+                }
+                Dst[Texel * 4 + 3] = uint8_t(std::min(Color.a, 1.0f) * 255.0f + 0.5f);
+            }
+        });
+        std::swap(Current, Next);
+    }
+}
+
+//Bytes of a block of BlockExtent x BlockExtent texels, uncompressed formats have one texel blocks. False for formats textures can't use.
+bool GetTextureFormatBlock(VkFormat Format, uint32_t& BlockExtent, uint32_t& BlockBytes)
+{
+    switch (Format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        BlockExtent = 1;
+        BlockBytes = 4;
+        return true;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        BlockExtent = 4;
+        BlockBytes = 8;
+        return true;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        BlockExtent = 4;
+        BlockBytes = 16;
+        return true;
+    default:
+        return false;
+    }
+}
+
+uint64_t GetTextureLevelSize(uint32_t BlockExtent, uint32_t BlockBytes, uint32_t Width, uint32_t Height, uint32_t Level)
+{
+    uint64_t BlocksWide = (GetMipExtent(Width, Level) + BlockExtent - 1) / BlockExtent;
+    uint64_t BlocksHigh = (GetMipExtent(Height, Level) + BlockExtent - 1) / BlockExtent;
+    return BlocksWide * BlocksHigh * BlockBytes;
+}
+
+struct TextureLevel
+{
+    uint64_t Offset;
+    uint64_t Size;
+};
+
+//Every mip level of a single 2D image in the format it gets uploaded in
+struct TextureImageData
+{
+    VkFormat Format = VK_FORMAT_UNDEFINED;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    std::vector<TextureLevel> Levels;
+    //Levels point into the mapped file when the texture was read from one and into Storage when it was built in memory
+    std::unique_ptr<MappedFile> File;
+    std::vector<uint8_t> Storage;
+    const uint8_t* Bytes = nullptr;
+    //Hash and size of the file the texture came from, two paths with the same ones hold the same texture
+    uint64_t ContentHash = 0;
+    uint64_t ContentSize = 0;
+};
+
+//Endpoints along the principal axis of the block's colors, every texel picks the closest of the four palette colors.
+//Texels are RGBA, the alpha is ignored.
+void EncodeBc1Block(const uint8_t (&Texels)[16][4], uint8_t* Dst)
+{
+    glm::vec3 Colors[16];
+    glm::vec3 Mean(0.0f);
+    for (int i = 0; i < 16; i++)
+    {
+        Colors[i] = glm::vec3(Texels[i][0], Texels[i][1], Texels[i][2]);
+        Mean += Colors[i];
+    }
+    Mean /= 16.0f;
+
+    float Covariance[6] = {};
+    glm::vec3 Min(255.0f), Max(0.0f);
+    for (int i = 0; i < 16; i++)
+    {
+        glm::vec3 D = Colors[i] - Mean;
+        Covariance[0] += D.x * D.x; Covariance[1] += D.x * D.y; Covariance[2] += D.x * D.z;
+        Covariance[3] += D.y * D.y; Covariance[4] += D.y * D.z; Covariance[5] += D.z * D.z;
+        Min = glm::min(Min, Colors[i]);
+        Max = glm::max(Max, Colors[i]);
+    }
+
+    //A few power iterations from the box diagonal are enough to find the dominant direction
+    glm::vec3 Axis = Max - Min;
+    for (int Iteration = 0; Iteration < 4; Iteration++)
+    {
+        Axis = glm::vec3(Covariance[0] * Axis.x + Covariance[1] * Axis.y + Covariance[2] * Axis.z,
+            Covariance[1] * Axis.x + Covariance[3] * Axis.y + Covariance[4] * Axis.z,
+            Covariance[2] * Axis.x + Covariance[4] * Axis.y + Covariance[5] * Axis.z);
+        float Length = glm::length(Axis);
+        if (Length < 1e-6f) break;
+        Axis /= Length;
+    }
+
+    glm::vec3 Endpoints[2] = { Mean, Mean };
+    if (glm::dot(Axis, Axis) > 1e-6f)
+    {
+        Axis = glm::normalize(Axis);
+        float MinProjection = 0.0f, MaxProjection = 0.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            float Projection = glm::dot(Colors[i] - Mean, Axis);
+            MinProjection = std::min(MinProjection, Projection);
+            MaxProjection = std::max(MaxProjection, Projection);
+        }
+        Endpoints[0] = glm::clamp(Mean + Axis * MaxProjection, glm::vec3(0.0f), glm::vec3(255.0f));
+        Endpoints[1] = glm::clamp(Mean + Axis * MinProjection, glm::vec3(0.0f), glm::vec3(255.0f));
+    }
+
+    uint16_t Packed[2];
+    for (int e = 0; e < 2; e++)
+    {
+        uint32_t R = uint32_t(Endpoints[e].x * 31.0f / 255.0f + 0.5f), G = uint32_t(Endpoints[e].y * 63.0f / 255.0f + 0.5f), B = uint32_t(Endpoints[e].z * 31.0f / 255.0f + 0.5f);
+        Packed[e] = uint16_t((R << 11) | (G << 5) | B);
+    }
+    //The four color mode needs the first endpoint to be the larger one, equal endpoints leave every index at zero
+    if (Packed[0] < Packed[1]) std::swap(Packed[0], Packed[1]);
+
+    glm::vec3 Palette[4];
+    for (int e = 0; e < 2; e++)
+    {
+        uint32_t R = Packed[e] >> 11, G = (Packed[e] >> 5) & 63, B = Packed[e] & 31;
+        Palette[e] = glm::vec3(float((R << 3) | (R >> 2)), float((G << 2) | (G >> 4)), float((B << 3) | (B >> 2)));
+    }
+    Palette[2] = (Palette[0] * 2.0f + Palette[1]) / 3.0f;
+    Palette[3] = (Palette[0] + Palette[1] * 2.0f) / 3.0f;
+
+    uint32_t Indices = 0;
+    if (Packed[0] != Packed[1])
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            uint32_t Best = 0;
+            float BestDistance = std::numeric_limits<float>::max();
+            for (uint32_t p = 0; p < 4; p++)
+            {
+                glm::vec3 D = Colors[i] - Palette[p];
+                float Distance = glm::dot(D, D);
+                if (Distance < BestDistance)
+                {
+                    BestDistance = Distance;
+                    Best = p;
+                }
+            }
+            Indices |= Best << (i * 2);
+        }
+    }
+
+    memcpy(Dst, Packed, 4);
+    memcpy(Dst + 4, &Indices, 4);
+}
+
+//The alpha half of a BC3 block, eight values between the block's extremes
+void EncodeBc3AlphaBlock(const uint8_t (&Texels)[16][4], uint8_t* Dst)
+{
+    uint8_t MinAlpha = 255, MaxAlpha = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        MinAlpha = std::min(MinAlpha, Texels[i][3]);
+        MaxAlpha = std::max(MaxAlpha, Texels[i][3]);
+    }
+
+    uint64_t Bits = uint64_t(MaxAlpha) | (uint64_t(MinAlpha) << 8);
+    if (MaxAlpha != MinAlpha)
+    {
+        //Index 0 is the maximum, 1 the minimum and 2 to 7 step from the maximum towards the minimum
+        for (int i = 0; i < 16; i++)
+        {
+            uint32_t Step = uint32_t((MaxAlpha - Texels[i][3]) * 7 + (MaxAlpha - MinAlpha) / 2) / (MaxAlpha - MinAlpha);
+            uint64_t Index = Step == 0 ? 0 : Step == 7 ? 1 : Step + 1;
+            Bits |= Index << (16 + i * 3);
+        }
+    }
+    memcpy(Dst, &Bits, 8);
+}
+
+//Block compresses a chain built by BuildSrgbMipChain, BC1 when every texel is opaque and BC3 otherwise
+void CompressSrgbMipChain(const std::vector<uint8_t>& Chain, const std::vector<size_t>& LevelOffsets, uint32_t Width, uint32_t Height, TextureImageData& DstTexture)
+{
+    bool IsOpaque = true;
+    for (size_t Texel = 0; Texel < size_t(Width) * Height && IsOpaque; Texel++)
+    {
+        IsOpaque = Chain[Texel * 4 + 3] == 255;
+    }
+
+    DstTexture.Format = IsOpaque ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC3_SRGB_BLOCK;
+    DstTexture.Width = Width;
+    DstTexture.Height = Height;
+    uint32_t BlockExtent, BlockBytes;
+    GetTextureFormatBlock(DstTexture.Format, BlockExtent, BlockBytes);
+
+    uint64_t Size = 0;
+    DstTexture.Levels.resize(LevelOffsets.size());
+    for (uint32_t Level = 0; Level < LevelOffsets.size(); Level++)
+    {
+        DstTexture.Levels[Level] = { Size, GetTextureLevelSize(BlockExtent, BlockBytes, Width, Height, Level) };
+        Size += DstTexture.Levels[Level].Size;
+    }
+    DstTexture.Storage.resize(Size);
+    DstTexture.Bytes = DstTexture.Storage.data();
+
+    for (uint32_t Level = 0; Level < LevelOffsets.size(); Level++)
+    {
+        uint32_t LevelWidth = GetMipExtent(Width, Level), LevelHeight = GetMipExtent(Height, Level);
+        uint32_t BlocksWide = (LevelWidth + 3) / 4, BlocksHigh = (LevelHeight + 3) / 4;
+        const uint8_t* Src = Chain.data() + LevelOffsets[Level];
+        uint8_t* Dst = DstTexture.Storage.data() + DstTexture.Levels[Level].Offset;
+        ParallelFor(BlocksHigh, 4, [&](size_t Begin, size_t End)
+        {
+            uint8_t Texels[16][4];
+            for (size_t BlockY = Begin; BlockY < End; BlockY++)
+            {
+                for (uint32_t BlockX = 0; BlockX < BlocksWide; BlockX++)
                 {
-                    NewMesh.Indices.push_back(Face.mIndices[Index]);
+                    //Blocks hanging over the edge repeat the last row and column
+                    for (uint32_t i = 0; i < 16; i++)
+                    {
+                        size_t X = std::min(BlockX * 4 + i % 4, LevelWidth - 1), Y = std::min<size_t>(BlockY * 4 + i / 4, LevelHeight - 1);
+                        memcpy(Texels[i], Src + (Y * LevelWidth + X) * 4, 4);
+                    }
+                    uint8_t* Block = Dst + (BlockY * BlocksWide + BlockX) * BlockBytes;
+                    if (IsOpaque)
+                    {
+                        EncodeBc1Block(Texels, Block);
+                    }
+                    else
+                    {
+                        EncodeBc3AlphaBlock(Texels, Block);
+                        EncodeBc1Block(Texels, Block + 8);
+                    }
                 }
             }
-            DstModel.Meshes.push_back(NewMesh);
+        });
+    }
+}
+
+const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+//Key/value entries a cooked texture carries, in the sorted order the format asks for
+const char KTX2_DECODE_TIME_KEY[] = "CookedDecodeMilliseconds";
+const char KTX2_SOURCE_HASH_KEY[] = "CookedSourceHash";
+
+//What a cooked KTX2 file remembers of its source, both zero for files from elsewhere
+struct CookedTextureInfo
+{
+    uint64_t SourceHash = 0;
+    //How long decoding the source took when it was cooked, so loads can report what the cache saved
+    double DecodeMilliseconds = 0.0;
+};
+
+struct Ktx2Header
+{
+    uint8_t Identifier[12];
+    uint32_t Format;
+    uint32_t TypeSize;
+    uint32_t PixelWidth;
+    uint32_t PixelHeight;
+    uint32_t PixelDepth;
+    uint32_t LayerCount;
+    uint32_t FaceCount;
+    uint32_t LevelCount;
+    uint32_t SupercompressionScheme;
+    uint32_t DfdByteOffset;
+    uint32_t DfdByteLength;
+    uint32_t KvdByteOffset;
+    uint32_t KvdByteLength;
+    uint64_t SgdByteOffset;
+    uint64_t SgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header must match the KTX2 layout");
+
+struct Ktx2LevelIndex
+{
+    uint64_t ByteOffset;
+    uint64_t ByteLength;
+    uint64_t UncompressedByteLength;
+};
+
+//Basic data format descriptor of the formats the cooker writes, readers of this renderer go by the header's format alone
+std::vector<uint32_t> BuildKtx2DataFormatDescriptor(VkFormat Format)
+{
+    struct Sample
+    {
+        uint32_t BitOffset;
+        uint32_t BitLength;
+        uint32_t Channel;
+        uint32_t Upper;
+    };
+    const uint32_t SampleLinear = 0x10;
+    uint32_t ColorModel, BlockExtent, BlockBytes;
+    std::vector<Sample> Samples;
+    GetTextureFormatBlock(Format, BlockExtent, BlockBytes);
+    switch (Format)
+    {
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        ColorModel = 128;
+        Samples = { { 0, 64, 0, 0xFFFFFFFF } };
+        break;
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        ColorModel = 130;
+        Samples = { { 0, 64, 15 | SampleLinear, 0xFFFFFFFF }, { 64, 64, 0, 0xFFFFFFFF } };
+        break;
+    default:
+        ColorModel = 1;
+        Samples = { { 0, 8, 0, 255 }, { 8, 8, 1, 255 }, { 16, 8, 2, 255 }, { 24, 8, 15 | SampleLinear, 255 } };
+        break;
+    }
+    bool IsSrgb = Format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || Format == VK_FORMAT_BC3_SRGB_BLOCK || Format == VK_FORMAT_R8G8B8A8_SRGB;
+
+    uint32_t BlockSize = 24 + 16 * uint32_t(Samples.size());
+    std::vector<uint32_t> Words = { 4 + BlockSize, 0, 2 | (BlockSize << 16), ColorModel | (1 << 8) | ((IsSrgb ? 2u : 1u) << 16),
+        (BlockExtent - 1) | ((BlockExtent - 1) << 8), BlockBytes, 0 };
+    for (const Sample& S : Samples)
+    {
+        Words.insert(Words.end(), { S.BitOffset | ((S.BitLength - 1) << 16) | (S.Channel << 24), 0, 0, S.Upper });
+    }
+    return Words;
+}
+
+//Maps a KTX2 file holding a single non supercompressed 2D image, its levels are used in place
+bool ReadKtx2Texture(const char* FilePath, TextureImageData& DstTexture, CookedTextureInfo& DstInfo)
+{
+    auto File = std::make_unique<MappedFile>();
+    if (!File->Open(FilePath) || File->Data == nullptr || File->Size < sizeof(Ktx2Header)) return false;
+
+    Ktx2Header Header;
+    memcpy(&Header, File->Data, sizeof(Header));
+    uint32_t LevelCount = std::max(Header.LevelCount, 1u);
+    uint32_t BlockExtent, BlockBytes;
+    if (memcmp(Header.Identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0 || !GetTextureFormatBlock(VkFormat(Header.Format), BlockExtent, BlockBytes) ||
+        Header.PixelWidth == 0 || Header.PixelHeight == 0 || Header.PixelDepth != 0 || Header.LayerCount > 1 || Header.FaceCount != 1 ||
+        Header.SupercompressionScheme != 0 || LevelCount > GetMipLevelCount(Header.PixelWidth, Header.PixelHeight) ||
+        sizeof(Header) + sizeof(Ktx2LevelIndex) * uint64_t(LevelCount) > File->Size ||
+        uint64_t(Header.KvdByteOffset) + Header.KvdByteLength > File->Size)
+    {
+        return false;
+    }
+
+    std::vector<TextureLevel> Levels(LevelCount);
+    for (uint32_t Level = 0; Level < LevelCount; Level++)
+    {
+        Ktx2LevelIndex Index;
+        memcpy(&Index, File->Data + sizeof(Header) + sizeof(Ktx2LevelIndex) * Level, sizeof(Index));
+        if (Index.ByteLength != GetTextureLevelSize(BlockExtent, BlockBytes, Header.PixelWidth, Header.PixelHeight, Level) ||
+            Index.ByteOffset > File->Size || Index.ByteLength > File->Size - Index.ByteOffset)
+        {
+            return false;
+        }
+        Levels[Level] = { Index.ByteOffset, Index.ByteLength };
+    }
+
+    DstInfo = CookedTextureInfo();
+    const char* Kvd = File->Data + Header.KvdByteOffset;
+    for (uint32_t Offset = 0; Offset + 4 <= Header.KvdByteLength;)
+    {
+        uint32_t Length;
+        memcpy(&Length, Kvd + Offset, 4);
+        if (Length > Header.KvdByteLength - Offset - 4) break;
+        const char* Entry = Kvd + Offset + 4;
+        auto ReadValue = [&](const auto& Key, auto& Value)
+        {
+            if (Length == sizeof(Key) + sizeof(Value) && memcmp(Entry, Key, sizeof(Key)) == 0)
+            {
+                memcpy(&Value, Entry + sizeof(Key), sizeof(Value));
+            }
+        };
+        ReadValue(KTX2_DECODE_TIME_KEY, DstInfo.DecodeMilliseconds);
+        ReadValue(KTX2_SOURCE_HASH_KEY, DstInfo.SourceHash);
+        Offset += 4 + ((Length + 3) & ~3u);
+    }
+
+    DstTexture.Format = VkFormat(Header.Format);
+    DstTexture.Width = Header.PixelWidth;
+    DstTexture.Height = Header.PixelHeight;
+    DstTexture.Levels = std::move(Levels);
+    DstTexture.Storage.clear();
+    DstTexture.Bytes = reinterpret_cast<const uint8_t*>(File->Data);
+    DstTexture.File = std::move(File);
+    return true;
+}
+
+//Levels are stored smallest first as the format asks for, each one aligned to its block size
+void WriteKtx2Texture(const char* FilePath, const CookedTextureInfo& Info, const TextureImageData& SrcTexture)
+{
+    uint32_t BlockExtent, BlockBytes;
+    GetTextureFormatBlock(SrcTexture.Format, BlockExtent, BlockBytes);
+    uint32_t LevelCount = static_cast<uint32_t>(SrcTexture.Levels.size());
+    std::vector<uint32_t> Dfd = BuildKtx2DataFormatDescriptor(SrcTexture.Format);
+
+    //Every entry is its length, the key with its terminator and the value, padded to 4 bytes
+    std::vector<uint8_t> Kvd;
+    auto WriteValue = [&](const auto& Key, const auto& Value)
+    {
+        uint32_t EntryLength = sizeof(Key) + sizeof(Value);
+        size_t Offset = Kvd.size();
+        Kvd.resize(Offset + ((4 + EntryLength + 3) & ~size_t(3)));
+        memcpy(Kvd.data() + Offset, &EntryLength, 4);
+        memcpy(Kvd.data() + Offset + 4, Key, sizeof(Key));
+        memcpy(Kvd.data() + Offset + 4 + sizeof(Key), &Value, sizeof(Value));
+    };
+    WriteValue(KTX2_DECODE_TIME_KEY, Info.DecodeMilliseconds);
+    WriteValue(KTX2_SOURCE_HASH_KEY, Info.SourceHash);
+
+    Ktx2Header Header{};
+    memcpy(Header.Identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    Header.Format = SrcTexture.Format;
+    Header.TypeSize = 1;
+    Header.PixelWidth = SrcTexture.Width;
+    Header.PixelHeight = SrcTexture.Height;
+    Header.FaceCount = 1;
+    Header.LevelCount = LevelCount;
+    Header.DfdByteOffset = static_cast<uint32_t>(sizeof(Header) + sizeof(Ktx2LevelIndex) * LevelCount);
+    Header.DfdByteLength = static_cast<uint32_t>(sizeof(uint32_t) * Dfd.size());
+    Header.KvdByteOffset = Header.DfdByteOffset + Header.DfdByteLength;
+    Header.KvdByteLength = static_cast<uint32_t>(Kvd.size());
+
+    const uint64_t Alignment = std::max<uint64_t>(BlockBytes, 4);
+    std::vector<Ktx2LevelIndex> Index(LevelCount);
+    uint64_t Offset = Header.KvdByteOffset + Header.KvdByteLength;
+    for (uint32_t Level = LevelCount; Level-- > 0;)
+    {
+        Offset = (Offset + Alignment - 1) / Alignment * Alignment;
+        Index[Level] = { Offset, SrcTexture.Levels[Level].Size, SrcTexture.Levels[Level].Size };
+        Offset += SrcTexture.Levels[Level].Size;
+    }
+
+    std::string TemporaryPath = std::string(FilePath) + ".tmp";
+    std::ofstream File(TemporaryPath, std::ios::binary | std::ios::trunc);
+    if (!File.is_open())
+    {
+        std::cout << "Unable to write the cooked texture " << FilePath << std::endl;
+        return;
+    }
+
+    const char Padding[16] = {};
+    uint64_t Written = 0;
+    auto Write = [&](const void* Data, uint64_t Size)
+    {
+        File.write(static_cast<const char*>(Data), Size);
+        Written += Size;
+    };
+
+    Write(&Header, sizeof(Header));
+    Write(Index.data(), sizeof(Ktx2LevelIndex) * Index.size());
+    Write(Dfd.data(), Header.DfdByteLength);
+    Write(Kvd.data(), Kvd.size());
+    for (uint32_t Level = LevelCount; Level-- > 0;)
+    {
+        Write(Padding, Index[Level].ByteOffset - Written);
+        Write(SrcTexture.Bytes + SrcTexture.Levels[Level].Offset, SrcTexture.Levels[Level].Size);
+    }
+    File.close();
+
+    if (!File)
+    {
+        std::remove(TemporaryPath.c_str());
+        std::cout << "Unable to write the cooked texture " << FilePath << std::endl;
+        return;
+    }
+    std::remove(FilePath);
+    std::rename(TemporaryPath.c_str(), FilePath);
+}
+
+bool IsKtx2File(const char* FilePath)
+{
+    size_t Length = strlen(FilePath);
+    return Length >= 5 && (strcmp(FilePath + Length - 5, ".ktx2") == 0 || strcmp(FilePath + Length - 5, ".KTX2") == 0);
+}
+
+//What the device takes, decides what an image is cooked into
+struct TextureCookTarget
+{
+    //BC1 or BC3 with every mip level, otherwise RGBA8
+    bool BlockCompressed = false;
+    //RGBA8 only, without it just the base level is stored and the GPU blits the rest of the chain
+    bool FullMipChain = true;
+};
+
+//Falls back to the path as given when it can't be resolved, loading it reports the error
+std::string GetCanonicalPath(const char* FilePath)
+{
+    std::error_code Error;
+    std::filesystem::path Path = std::filesystem::weakly_canonical(FilePath, Error);
+    return Error ? std::string(FilePath) : Path.string();
+}
+
+//Byte for byte, used where a matching hash alone isn't trusted
+bool HaveSameContents(const char* FilePathA, const char* FilePathB)
+{
+    MappedFile FileA, FileB;
+    if (!FileA.Open(FilePathA) || !FileB.Open(FilePathB) || FileA.Size != FileB.Size) return false;
+    return FileA.Size == 0 || memcmp(FileA.Data, FileB.Data, FileA.Size) == 0;
+}
+
+std::string GetCookedTexturePath(const char* FilePath, const TextureCookTarget& Target)
+{
+    return std::string(FilePath) + (Target.BlockCompressed ? ".ktx2" : ".rgba.ktx2");
+}
+
+bool IsCookedForTarget(const TextureImageData& Texture, const TextureCookTarget& Target)
+{
+    bool IsBlockCompressed = Texture.Format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || Texture.Format == VK_FORMAT_BC3_SRGB_BLOCK;
+    uint32_t LevelCount = Target.BlockCompressed || Target.FullMipChain ? GetMipLevelCount(Texture.Width, Texture.Height) : 1;
+    return IsBlockCompressed == Target.BlockCompressed && (IsBlockCompressed || Texture.Format == VK_FORMAT_R8G8B8A8_SRGB) && Texture.Levels.size() == LevelCount;
+}
+
+//KTX2 files are used as they are. Any other image is decoded once and cooked into a KTX2 file next to it, block compressed or as raw
+//RGBA8 depending on the target. While the source stays the same later loads map that file and its levels are copied from the mapping
+//straight into staging memory, stb_image isn't involved.
+void LoadTexture(const char* FilePath, const TextureCookTarget& Target, TextureImageData& DstTexture)
+{
+    auto StartTime = std::chrono::high_resolution_clock::now();
+    CookedTextureInfo Info;
+    if (IsKtx2File(FilePath))
+    {
+        if (!ReadKtx2Texture(FilePath, DstTexture, Info))
+        {
+            throw std::runtime_error("Unable to read the KTX2 texture(" + std::string(FilePath) + ")");
+        }
+        DstTexture.ContentHash = HashBytes(DstTexture.File->Data, DstTexture.File->Size);
+        DstTexture.ContentSize = DstTexture.File->Size;
+        return;
+    }
+
+    MappedFile Source;
+    if (!Source.Open(FilePath) || Source.Data == nullptr)
+    {
+        throw std::runtime_error("Unable to load the image(" + std::string(FilePath) + ")");
+    }
+    uint64_t ContentHash = HashBytes(Source.Data, Source.Size);
+    uint64_t SourceHash = HashBytes(&COOKED_TEXTURE_VERSION, sizeof(COOKED_TEXTURE_VERSION), ContentHash);
+
+    std::string CachePath = GetCookedTexturePath(FilePath, Target);
+    bool IsCacheHit = ReadKtx2Texture(CachePath.c_str(), DstTexture, Info) && Info.SourceHash == SourceHash && IsCookedForTarget(DstTexture, Target);
+    double MipMilliseconds = 0.0;
+    if (!IsCacheHit)
+    {
+        DstTexture = TextureImageData();
+        Info.SourceHash = SourceHash;
+
+        int Width, Height, ChannelCount;
+        auto DecodeStartTime = std::chrono::high_resolution_clock::now();
+        auto Pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(Source.Data), static_cast<int>(Source.Size), &Width, &Height, &ChannelCount, STBI_rgb_alpha);
+        if (!Pixels)
+        {
+            throw std::runtime_error("Unable to load the image(" + std::string(FilePath) + ")");
+        }
+        auto DecodedTime = std::chrono::high_resolution_clock::now();
+        Info.DecodeMilliseconds = std::chrono::duration<double, std::milli>(DecodedTime - DecodeStartTime).count();
+
+        uint32_t LevelCount = Target.BlockCompressed || Target.FullMipChain ? GetMipLevelCount(Width, Height) : 1;
+        std::vector<uint8_t> MipChain;
+        std::vector<size_t> LevelOffsets;
+        BuildSrgbMipChain(Pixels, Width, Height, LevelCount, MipChain, LevelOffsets);
+        stbi_image_free(Pixels);
+        MipMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - DecodedTime).count();
+
+        if (Target.BlockCompressed)
+        {
+            CompressSrgbMipChain(MipChain, LevelOffsets, Width, Height, DstTexture);
+        }
+        else
+        {
+            DstTexture.Format = VK_FORMAT_R8G8B8A8_SRGB;
+            DstTexture.Width = Width;
+            DstTexture.Height = Height;
+            DstTexture.Levels.resize(LevelCount);
+            for (uint32_t Level = 0; Level < LevelCount; Level++)
+            {
+                DstTexture.Levels[Level] = { LevelOffsets[Level], GetTextureLevelSize(1, 4, Width, Height, Level) };
+            }
+            DstTexture.Storage = std::move(MipChain);
+            DstTexture.Bytes = DstTexture.Storage.data();
+        }
+        WriteKtx2Texture(CachePath.c_str(), Info, DstTexture);
+    }
+    DstTexture.ContentHash = ContentHash;
+    DstTexture.ContentSize = Source.Size;
+
+    uint64_t Size = 0;
+    for (const TextureLevel& Level : DstTexture.Levels)
+    {
+        Size += Level.Size;
+    }
+    const char* FormatName = DstTexture.Format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ? "BC1" : DstTexture.Format == VK_FORMAT_BC3_SRGB_BLOCK ? "BC3" : "RGBA8";
+    double Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count();
+
+    //Put together first, textures are loaded on several threads and their lines shouldn't interleave
+    std::ostringstream Message;
+    Message << (IsCacheHit ? "Loaded cooked texture " : "Cooked texture ") << FilePath << " :: " << DstTexture.Width << "x" << DstTexture.Height << " " << FormatName
+        << ", " << DstTexture.Levels.size() << " levels, " << Size / 1024 << "KB (" << Milliseconds << "ms";
+    if (IsCacheHit)
+    {
+        Message << " against " << Info.DecodeMilliseconds << "ms decoding the source)\n";
+    }
+    else
+    {
+        Message << ", " << Info.DecodeMilliseconds << "ms decoding, " << MipMilliseconds << "ms mips)\n";
+    }
+    std::cout << Message.str() << std::flush;
+}
+
+//Loads textures on worker threads and hands every one of them to OnLoaded on the calling thread as soon as it is ready, in the order
+//they finish, so their uploads are recorded while the rest are still being decoded. A texture is freed once OnLoaded returns.
+void LoadTextures(const std::vector<const char*>& Paths, const TextureCookTarget& Target, const std::function<void(size_t Index, TextureImageData& Texture)>& OnLoaded)
+{
+    if (Paths.empty()) return;
+
+    size_t ThreadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), Paths.size());
+    //The hardware threads are split between the workers, with fewer textures than threads every texture spreads its mips and
+    //compression over its share of them
+    size_t WorkerThreadBudget = std::max<size_t>(1, std::thread::hardware_concurrency() / ThreadCount);
+
+    std::atomic<size_t> NextTexture{ 0 };
+    std::mutex ReadyMutex;
+    std::condition_variable ReadyCondition;
+    std::deque<std::pair<size_t, std::unique_ptr<TextureImageData>>> ReadyTextures;
+    std::exception_ptr FirstException;
+    auto Worker = [&]()
+    {
+        ParallelForThreadBudget = WorkerThreadBudget;
+        try
+        {
+            for (size_t Index = NextTexture++; Index < Paths.size(); Index = NextTexture++)
+            {
+                auto Texture = std::make_unique<TextureImageData>();
+                LoadTexture(Paths[Index], Target, *Texture);
+                std::lock_guard<std::mutex> Lock(ReadyMutex);
+                ReadyTextures.emplace_back(Index, std::move(Texture));
+                ReadyCondition.notify_one();
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> Lock(ReadyMutex);
+            if (!FirstException) FirstException = std::current_exception();
+            NextTexture = Paths.size();
+            ReadyCondition.notify_one();
         }
+        ParallelForThreadBudget = 0;
+    };
 
-        for (size_t i = 0; i < Node->mNumChildren; i++)
+    std::vector<std::thread> Threads;
+    for (size_t i = 0; i < ThreadCount; i++)
+    {
+        Threads.emplace_back(Worker);
+    }
+
+    std::exception_ptr Exception;
+    try
+    {
+        for (size_t Handed = 0; Handed < Paths.size(); Handed++)
         {
-            NodesToProcess.push(*(Node->mChildren + i));
+            std::unique_lock<std::mutex> Lock(ReadyMutex);
+            ReadyCondition.wait(Lock, [&]() { return !ReadyTextures.empty() || FirstException; });
+            if (FirstException) break;
+            auto Ready = std::move(ReadyTextures.front());
+            ReadyTextures.pop_front();
+            Lock.unlock();
+            OnLoaded(Ready.first, *Ready.second);
         }
     }
+    catch (...)
+    {
+        Exception = std::current_exception();
+        NextTexture = Paths.size();
+    }
+
+    for (auto& Thread : Threads)
+    {
+        Thread.join();
+    }
+    if (!Exception) Exception = FirstException;
+    if (Exception) std::rethrow_exception(Exception);
 }
 
 const std::vector<Vertex3D> Vertices = {
@@ -282,6 +4869,75 @@ const std::vector<uint16_t> indices = {
     0, 1, 2, 2, 3, 0
 };
 
+//A texture on the GPU with every level of its chain
+struct TextureResource
+{
+    VkImage Image = VK_NULL_HANDLE;
+    VmaAllocation Allocation = VK_NULL_HANDLE;
+    VkImageView View = VK_NULL_HANDLE;
+    uint32_t MipLevels = 1;
+};
+
+//Index into the texture cache, stays valid until its last reference is released
+typedef uint32_t TextureHandle;
+const TextureHandle INVALID_TEXTURE_HANDLE = UINT32_MAX;
+
+//A texture shared by everything that acquired it, Paths lists every canonical path that led to it
+struct CachedTexture
+{
+    TextureResource Resource;
+    std::vector<std::string> Paths;
+    uint64_t ContentHash = 0;
+    uint64_t ContentSize = 0;
+    VkFormat Format = VK_FORMAT_UNDEFINED;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t ReferenceCount = 0;
+};
+
+//Key is kept to tell apart samplers whose create infos hash the same
+struct CachedSampler
+{
+    SamplerKey Key;
+    VkSampler Sampler = VK_NULL_HANDLE;
+    uint32_t ReferenceCount = 0;
+};
+
+//A released resource waits until the frames submitted before its release and the upload batch pending at that point are done
+struct RetiredResource
+{
+    uint64_t FrameNumber = 0;
+    UploadTicket Ticket = 0;
+    std::function<void()> Destroy;
+};
+
+//Every field that tells samplers apart, compared field by field since the padding inside the create info isn't guaranteed to be zeroed
+typedef std::tuple<VkSamplerCreateFlags, VkFilter, VkFilter, VkSamplerMipmapMode, VkSamplerAddressMode, VkSamplerAddressMode, VkSamplerAddressMode,
+    float, VkBool32, float, VkBool32, VkCompareOp, float, float, VkBorderColor, VkBool32> SamplerKey;
+
+//Extension structs aren't followed, samplers that need them can't be shared through the cache
+SamplerKey GetSamplerKey(const VkSamplerCreateInfo& CreateInfo)
+{
+    if (CreateInfo.pNext != nullptr)
+    {
+        throw std::runtime_error("Samplers with extension structs can't be cached!");
+    }
+
+    return SamplerKey(CreateInfo.flags, CreateInfo.magFilter, CreateInfo.minFilter, CreateInfo.mipmapMode, CreateInfo.addressModeU, CreateInfo.addressModeV,
+        CreateInfo.addressModeW, CreateInfo.mipLodBias, CreateInfo.anisotropyEnable, CreateInfo.maxAnisotropy, CreateInfo.compareEnable, CreateInfo.compareOp,
+        CreateInfo.minLod, CreateInfo.maxLod, CreateInfo.borderColor, CreateInfo.unnormalizedCoordinates);
+}
+
+uint64_t HashSamplerKey(const SamplerKey& Key)
+{
+    return std::apply([](const auto& First, const auto&... Rest)
+    {
+        uint64_t Hash = HashBytes(&First, sizeof(First));
+        ((Hash = HashBytes(&Rest, sizeof(Rest), Hash)), ...);
+        return Hash;
+    }, Key);
+}
+
 struct Matrixes {
     glm::mat4 ModelMatrix;
     glm::mat4 ViewMatrix;
@@ -311,6 +4967,14 @@ private:
     VkDevice LogicalDevice;
     VkQueue GraphicsQueue;
     VkQueue PresentQueue;
+    VkQueue UploadQueue;
+    uint32_t UploadQueueFamily;
+    std::vector<uint32_t> SharedQueueFamilies;
+
+    bool IsMultiDrawIndirectSupported = false;
+    bool IsDrawIndirectCountSupported = false;
+    uint32_t MaxDrawIndirectCount = 1;
+    bool IsTextureCompressionBCSupported = false;
     VkSurfaceKHR Surface;
 
 
@@ -326,7 +4990,10 @@ private:
     VkDescriptorSetLayout DescriptorSetLayout;
     VkPipelineLayout PipelineLayout;
 
-    VkPipeline GraphicsPipeline;
+    //One pipeline per vertex format, they only differ in the vertex shader and its input layout
+    std::array<VkPipeline, VERTEX_FORMAT_COUNT> GraphicsPipelines;
+    //Bind only the position stream, used by the depth prepass
+    std::array<VkPipeline, VERTEX_FORMAT_COUNT> DepthPipelines;
 
     VkCommandPool CommandPool;
 
@@ -336,17 +5003,58 @@ private:
     std::vector<VkSemaphore> RenderFinishedSemophores;
     std::vector<VkFence> InFlightFences;
 
-    VkBuffer VertexBuffer;
-    VkDeviceMemory VertexBufferMemory;
-
-    VkBuffer IndexBuffer;
-    VkDeviceMemory IndexBufferMemory;
+    VmaAllocator Allocator;
+    UploadEngine Uploads;
+    UploadTicket SceneUploadTicket = 0;
+
+    GeometryStore Geometry;
+    DrawSubmissionMode DrawMode = DrawSubmissionMode::Indirect;
+    bool IsDepthPrepassEnabled = false;
+    bool IsMeshletCullingEnabled = true;
+    //Matrices of the frame being recorded, the culling shader gets them through push constants
+    Matrixes FrameMatrixes;
+
+    //Every frame in flight draws from its own copy of the draw commands, written after the frame's LOD selection
+    std::vector<VkBuffer> IndirectBuffers;
+    std::vector<VmaAllocation> IndirectBuffersAllocation;
+    std::vector<void*> IndirectBuffersMapped;
+    bool IsLodSelectionEnabled = true;
+    LodSelectionSettings LodSettings;
+    //Level drawn for every scene mesh this frame
+    std::vector<uint32_t> SelectedLods;
+    uint64_t LodTrianglesDrawn = 0;
+    uint64_t LodTrianglesSaved = 0;
+    //Meshes whose cluster DAG the culling pass cut, their triangles only show up in the culled counts
+    uint64_t LodClusterDagMeshesDrawn = 0;
+
+    VkDescriptorSetLayout MeshletCullDescriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout MeshletCullPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline MeshletCullPipeline = VK_NULL_HANDLE;
+    VkDescriptorPool MeshletCullDescriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> MeshletCullDescriptorSets;
+    //Culling output of every frame in flight, a frame's draws may still read it while the next one culls
+    std::vector<VkBuffer> CulledDrawTemplateBuffers;
+    std::vector<VmaAllocation> CulledDrawTemplateBuffersAllocation;
+    std::vector<void*> CulledDrawTemplateBuffersMapped;
+    std::vector<VkBuffer> CulledDrawBuffers;
+    std::vector<VmaAllocation> CulledDrawBuffersAllocation;
+    std::vector<VkBuffer> CulledIndexBuffers;
+    std::vector<VmaAllocation> CulledIndexBuffersAllocation;
+    //Host copy of every frame's culled draws, read once the frame's fence has signaled to count the triangles the culling pass kept
+    std::vector<VkBuffer> CulledDrawReadbackBuffers;
+    std::vector<VmaAllocation> CulledDrawReadbackBuffersAllocation;
+    std::vector<void*> CulledDrawReadbackBuffersMapped;
+    std::vector<uint8_t> IsCulledDrawReadbackPending;
+    uint64_t CulledTrianglesDrawn = 0;
+    uint32_t CulledFrameCount = 0;
+    double RecordTimeAccumulated = 0.0;
+    uint32_t RecordedFrameCount = 0;
 
     VkDescriptorPool DescriptorPool;
     std::vector<VkDescriptorSet> DescriptorSets;
 
     std::vector<VkBuffer> UniformBuffers;
-    std::vector<VkDeviceMemory> UniformBuffersMemory;
+    std::vector<VmaAllocation> UniformBuffersAllocation;
     std::vector<void*> UniformBuffersMapped;
 
     bool FrameBufferResized = false;
@@ -354,17 +5062,38 @@ private:
 
     std::vector<VkFramebuffer> SwapChainFramebuffers;
 
-    VkImage TextureImage;
-    VkDeviceMemory TextureImageMemory;
-    VkImageView TextureImageView;
+    //Same order as SceneTexturePaths, the descriptor sets sample the first one
+    std::vector<TextureHandle> SceneTextures;
     VkSampler TextureSampler;
 
+    //Textures are shared by canonical path and by content, samplers by a hash of their create info. Released ones are destroyed
+    //once the GPU can no longer be using them.
+    std::vector<CachedTexture> CachedTextures;
+    std::vector<TextureHandle> FreeTextureHandles;
+    std::map<std::string, TextureHandle> TexturesByPath;
+    std::multimap<uint64_t, TextureHandle> TexturesByContent;
+    std::multimap<uint64_t, CachedSampler> CachedSamplers;
+    uint32_t SamplerCount = 0;
+    uint32_t MaxSamplerAllocationCount = 0;
+    std::deque<RetiredResource> RetiredResources;
+    uint64_t SubmittedFrameCount = 0;
+
+    //Blits building mip chains on the graphics queue, recorded while textures are created and submitted once the scene upload is flushed
+    VkCommandBuffer MipGenerationCommandBuffer = VK_NULL_HANDLE;
+
     VkImage DepthBufferImage;
-    VkDeviceMemory DepthBufferImageMemory;
+    VmaAllocation DepthBufferImageAllocation;
     VkImageView DepthBufferImageView;
     VkFormat DepthImageFormat;
 
-    Model3D Model;
+    std::vector<Model3D> Models;
+    ImportSettings SceneImportSettings;
+    const std::vector<const char*> SceneModelPaths = {
+        "resources\\Shovel2.obj"
+    };
+    const std::vector<const char*> SceneTexturePaths = {
+        "resources\\image.png"
+    };
 
     const std::vector<const char*> ValidationLayers = {
         "VK_LAYER_KHRONOS_validation"
@@ -385,6 +5114,37 @@ private:
         window = glfwCreateWindow(WindowInitialWidth, WindowInitialHeight, "Vulkan", nullptr, nullptr);
         glfwSetWindowUserPointer(window, this);
         glfwSetFramebufferSizeCallback(window, FramebufferResizeCallback);
+        glfwSetKeyCallback(window, KeyCallback);
+    }
+
+    static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+    {
+        auto App = reinterpret_cast<HelloWorldTriangle*>(glfwGetWindowUserPointer(window));
+        if (key == GLFW_KEY_I && action == GLFW_PRESS)
+        {
+            App->DrawMode = App->DrawMode == DrawSubmissionMode::Indirect ? DrawSubmissionMode::Direct : DrawSubmissionMode::Indirect;
+            App->RecordTimeAccumulated = 0.0;
+            App->RecordedFrameCount = 0;
+            App->LodTrianglesDrawn = 0;
+            App->LodTrianglesSaved = 0;
+            App->LodClusterDagMeshesDrawn = 0;
+            std::cout << "Draw submission: " << (App->DrawMode == DrawSubmissionMode::Indirect ? "indirect" : "direct") << std::endl;
+        }
+        else if (key == GLFW_KEY_C && action == GLFW_PRESS)
+        {
+            App->IsMeshletCullingEnabled = !App->IsMeshletCullingEnabled;
+            std::cout << "Meshlet culling: " << (App->IsMeshletCullingEnabled ? "on" : "off") << std::endl;
+        }
+        else if (key == GLFW_KEY_P && action == GLFW_PRESS)
+        {
+            App->IsDepthPrepassEnabled = !App->IsDepthPrepassEnabled;
+            std::cout << "Depth prepass: " << (App->IsDepthPrepassEnabled ? "on" : "off") << std::endl;
+        }
+        else if (key == GLFW_KEY_L && action == GLFW_PRESS)
+        {
+            App->IsLodSelectionEnabled = !App->IsLodSelectionEnabled;
+            std::cout << "LOD selection: " << (App->IsLodSelectionEnabled ? "on" : "off") << std::endl;
+        }
     }
 
     static void FramebufferResizeCallback(GLFWwindow* window, int width, int height)
@@ -400,12 +5160,14 @@ private:
         CreateSurface();
         PickPhysicalDevice();
         CreateLogicalDevice();
+        CreateMemoryAllocator();
         CreateSwapChain();
         CreateImageViews();
         CreateDepthBufferResources();
         //CreateRenderPass();
         CreateCommandPool();
-        CreateTextureImage("resources\\image.png");
+        CreateUploadEngine();
+        CreateSceneTextures();
         CreateDescriptorSetLayout();
         CreateDescriptorPool();
         CreateUniformBuffers();
@@ -413,10 +5175,13 @@ private:
         CreateGraphicsPipeline();
         //CreateFramebuffers();
         CreateCommandBuffer();
-        Import3Dmodel("resources\\Shovel2.obj", Model);
-        CreateVertexBuffer();
-        CreateIndexBuffer();
+        ImportSceneModels();
+        CreateGeometryStore();
+        CreateMeshletCulling();
+        SceneUploadTicket = Uploads.Flush();
+        SubmitMipGeneration(SceneUploadTicket);
         CreateSyncObjects();
+        PrintMemoryStatistics();
     }
 
     void MainLoop()
@@ -434,26 +5199,47 @@ private:
     {
         CleanupSwapChain();
 
-        vkDestroySampler(LogicalDevice, TextureSampler, nullptr);
-        vkDestroyImageView(LogicalDevice, TextureImageView, nullptr);
-
-        vkDestroyImage(LogicalDevice, TextureImage, nullptr);
-        vkFreeMemory(LogicalDevice, TextureImageMemory, nullptr);
+        ReleaseSampler(TextureSampler);
+        for (TextureHandle Texture : SceneTextures)
+        {
+            ReleaseTexture(Texture);
+        }
+        DestroyRetiredResources(true);
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
-            vkDestroyBuffer(LogicalDevice, UniformBuffers[i], nullptr);
-            vkFreeMemory(LogicalDevice, UniformBuffersMemory[i], nullptr);
+            vmaDestroyBuffer(Allocator, UniformBuffers[i], UniformBuffersAllocation[i]);
         }
 
+        Uploads.Destroy();
+        vmaDestroyBuffer(Allocator, Uploads.StagingRing.Buffer, Uploads.StagingRing.Allocation);
+
         vkDestroyDescriptorPool(LogicalDevice, DescriptorPool, nullptr);
         vkDestroyDescriptorSetLayout(LogicalDevice, DescriptorSetLayout, nullptr);
 
-        vkDestroyBuffer(LogicalDevice, IndexBuffer, nullptr);
-        vkFreeMemory(LogicalDevice, IndexBufferMemory, nullptr);
-
-        vkDestroyBuffer(LogicalDevice, VertexBuffer, nullptr);
-        vkFreeMemory(LogicalDevice, VertexBufferMemory, nullptr);
+        for (size_t i = 0; i < CulledDrawBuffers.size(); i++)
+        {
+            vmaDestroyBuffer(Allocator, CulledDrawTemplateBuffers[i], CulledDrawTemplateBuffersAllocation[i]);
+            vmaDestroyBuffer(Allocator, CulledDrawBuffers[i], CulledDrawBuffersAllocation[i]);
+            vmaDestroyBuffer(Allocator, CulledIndexBuffers[i], CulledIndexBuffersAllocation[i]);
+            vmaDestroyBuffer(Allocator, CulledDrawReadbackBuffers[i], CulledDrawReadbackBuffersAllocation[i]);
+        }
+        vkDestroyDescriptorPool(LogicalDevice, MeshletCullDescriptorPool, nullptr);
+        vkDestroyPipeline(LogicalDevice, MeshletCullPipeline, nullptr);
+        vkDestroyPipelineLayout(LogicalDevice, MeshletCullPipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(LogicalDevice, MeshletCullDescriptorSetLayout, nullptr);
+        vmaDestroyBuffer(Allocator, Geometry.MeshletTriangleBuffer, Geometry.MeshletTriangleBufferAllocation);
+        vmaDestroyBuffer(Allocator, Geometry.MeshletVertexBuffer, Geometry.MeshletVertexBufferAllocation);
+        vmaDestroyBuffer(Allocator, Geometry.MeshletBuffer, Geometry.MeshletBufferAllocation);
+
+        for (size_t i = 0; i < IndirectBuffers.size(); i++)
+        {
+            vmaDestroyBuffer(Allocator, IndirectBuffers[i], IndirectBuffersAllocation[i]);
+        }
+        vmaDestroyBuffer(Allocator, Geometry.DrawCountBuffer, Geometry.DrawCountBufferAllocation);
+        vmaDestroyBuffer(Allocator, Geometry.DrawDataBuffer, Geometry.DrawDataBufferAllocation);
+        vmaDestroyBuffer(Allocator, Geometry.IndexBuffer, Geometry.IndexBufferAllocation);
+        vmaDestroyBuffer(Allocator, Geometry.VertexBuffer, Geometry.VertexBufferAllocation);
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
@@ -468,7 +5254,14 @@ private:
         {
             vkDestroyFramebuffer(LogicalDevice, Framebuffer, nullptr);
         }*/
-        vkDestroyPipeline(LogicalDevice, GraphicsPipeline, nullptr);
+        for (auto Pipeline : GraphicsPipelines)
+        {
+            vkDestroyPipeline(LogicalDevice, Pipeline, nullptr);
+        }
+        for (auto Pipeline : DepthPipelines)
+        {
+            vkDestroyPipeline(LogicalDevice, Pipeline, nullptr);
+        }
         vkDestroyPipelineLayout(LogicalDevice, PipelineLayout, nullptr);
         //vkDestroyRenderPass(LogicalDevice, RenderPass, nullptr);
 
@@ -478,6 +5271,7 @@ private:
         }
 
         vkDestroySwapchainKHR(LogicalDevice, SwapChain, nullptr);*/
+        vmaDestroyAllocator(Allocator);
         vkDestroyDevice(LogicalDevice, nullptr);
         if (EnableValidationLayers)
         {
@@ -675,6 +5469,16 @@ private:
         VkPhysicalDeviceFeatures DeviceFeatures;
         vkGetPhysicalDeviceFeatures(Device, &DeviceFeatures);
         if (!DeviceFeatures.geometryShader) return 0;
+        //Indirect draws reach their DrawData through firstInstance
+        if (!DeviceFeatures.drawIndirectFirstInstance) return 0;
+
+        VkPhysicalDeviceVulkan12Features Vulkan12Features{};
+        Vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 DeviceFeatures2{};
+        DeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        DeviceFeatures2.pNext = &Vulkan12Features;
+        vkGetPhysicalDeviceFeatures2(Device, &DeviceFeatures2);
+        if (!Vulkan12Features.timelineSemaphore) return 0;
 
         int Score = 0;
         if (DeviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
@@ -728,22 +5532,33 @@ private:
         vkGetPhysicalDeviceQueueFamilyProperties(Device, &QueueFamilyCount, QueueFamilies.data());
 
         int i = 0;
+        bool IsTransferOnlyFamily = false;
         for (const auto& QueueFamily : QueueFamilies)
         {
-            VkBool32 DoesSupportPresent = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(Device, i, Surface, &DoesSupportPresent);
-            if (QueueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+            if (!Indices.isComplete())
             {
-                Indices.GraphicsFamily = i;
-            }
-            if (DoesSupportPresent)
-            {
-                Indices.PresentFamily = i;
+                VkBool32 DoesSupportPresent = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR(Device, i, Surface, &DoesSupportPresent);
+                //The graphics queue also runs the meshlet culling dispatches
+                if ((QueueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (QueueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
+                {
+                    Indices.GraphicsFamily = i;
+                }
+                if (DoesSupportPresent)
+                {
+                    Indices.PresentFamily = i;
+                }
             }
 
-            if (Indices.isComplete())
+            //Families without graphics support are backed by the copy engines, transfer only ones are preferred over async compute ones
+            if ((QueueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(QueueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
             {
-                break;
+                bool IsTransferOnly = !(QueueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT);
+                if (!Indices.TransferFamily.has_value() || (IsTransferOnly && !IsTransferOnlyFamily))
+                {
+                    Indices.TransferFamily = i;
+                    IsTransferOnlyFamily = IsTransferOnly;
+                }
             }
             i++;
         }
@@ -756,6 +5571,10 @@ private:
 
         std::vector<VkDeviceQueueCreateInfo> QueueCreateInfos;
         std::set<uint32_t> UniqueQueueFamilies = { indices.GraphicsFamily.value(),indices.PresentFamily.value() };
+        if (indices.TransferFamily.has_value())
+        {
+            UniqueQueueFamilies.insert(indices.TransferFamily.value());
+        }
 
         QueueCreateInfos.reserve(UniqueQueueFamilies.size());
 
@@ -770,9 +5589,28 @@ private:
             QueueCreateInfos.push_back(QueueCreateInfo);
         }
 
+        VkPhysicalDeviceVulkan12Features SupportedVulkan12Features{};
+        SupportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 SupportedFeatures{};
+        SupportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        SupportedFeatures.pNext = &SupportedVulkan12Features;
+        vkGetPhysicalDeviceFeatures2(PhysicalDevice, &SupportedFeatures);
+
+        VkPhysicalDeviceProperties DeviceProperties;
+        vkGetPhysicalDeviceProperties(PhysicalDevice, &DeviceProperties);
+
+        IsMultiDrawIndirectSupported = SupportedFeatures.features.multiDrawIndirect;
+        IsDrawIndirectCountSupported = SupportedVulkan12Features.drawIndirectCount;
+        MaxDrawIndirectCount = IsMultiDrawIndirectSupported ? DeviceProperties.limits.maxDrawIndirectCount : 1;
+        IsTextureCompressionBCSupported = SupportedFeatures.features.textureCompressionBC;
+        MaxSamplerAllocationCount = DeviceProperties.limits.maxSamplerAllocationCount;
+
         //TODO Soon to return
         VkPhysicalDeviceFeatures DeviceFeatures{};
         DeviceFeatures.samplerAnisotropy = VK_TRUE;
+        DeviceFeatures.multiDrawIndirect = IsMultiDrawIndirectSupported;
+        DeviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+        DeviceFeatures.textureCompressionBC = IsTextureCompressionBCSupported;
 
         VkDeviceCreateInfo DeviceCreateInfo{};
         DeviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -787,6 +5625,12 @@ private:
         DynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
         DynamicRenderingFeatures.dynamicRendering = VK_TRUE;
 
+        VkPhysicalDeviceVulkan12Features Vulkan12Features{};
+        Vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        Vulkan12Features.timelineSemaphore = VK_TRUE;
+        Vulkan12Features.drawIndirectCount = IsDrawIndirectCountSupported;
+        DynamicRenderingFeatures.pNext = &Vulkan12Features;
+
         DeviceCreateInfo.pNext = &DynamicRenderingFeatures;
 
         if (vkCreateDevice(PhysicalDevice, &DeviceCreateInfo, nullptr, &LogicalDevice) != VK_SUCCESS)
@@ -796,6 +5640,17 @@ private:
 
         vkGetDeviceQueue(LogicalDevice, indices.GraphicsFamily.value(), 0, &GraphicsQueue);
         vkGetDeviceQueue(LogicalDevice, indices.PresentFamily.value(), 0, &PresentQueue);
+
+        //Without a dedicated transfer family the uploads share the graphics queue
+        UploadQueueFamily = indices.TransferFamily.value_or(indices.GraphicsFamily.value());
+        vkGetDeviceQueue(LogicalDevice, UploadQueueFamily, 0, &UploadQueue);
+
+        //Resources written by the upload queue and read by the graphics queue are shared instead of transferring their ownership
+        SharedQueueFamilies = { indices.GraphicsFamily.value() };
+        if (UploadQueueFamily != indices.GraphicsFamily.value())
+        {
+            SharedQueueFamilies.push_back(UploadQueueFamily);
+        }
     }
 
     void CreateSurface()
@@ -963,18 +5818,24 @@ private:
     void CreateGraphicsPipeline()
     {
         CompileGLSL("09_shader_base.vert", "vert.spv");
+        CompileGLSL("09_shader_packed.vert", "vert_packed.spv");
+        CompileGLSL("09_shader_depth.vert", "vert_depth.spv");
+        CompileGLSL("09_shader_depth_packed.vert", "vert_depth_packed.spv");
         CompileGLSL("09_shader_base.frag", "frag.spv");
 
-        auto VertexShaderCode = ReadFile("shaders/vert.spv");
+        std::array<VkShaderModule, VERTEX_FORMAT_COUNT> VertexShaderModules;
+        VertexShaderModules[static_cast<uint32_t>(VertexFormat::Float)] = CreateShaderModule(ReadFile("shaders/vert.spv"));
+        VertexShaderModules[static_cast<uint32_t>(VertexFormat::Packed)] = CreateShaderModule(ReadFile("shaders/vert_packed.spv"));
+        std::array<VkShaderModule, VERTEX_FORMAT_COUNT> DepthShaderModules;
+        DepthShaderModules[static_cast<uint32_t>(VertexFormat::Float)] = CreateShaderModule(ReadFile("shaders/vert_depth.spv"));
+        DepthShaderModules[static_cast<uint32_t>(VertexFormat::Packed)] = CreateShaderModule(ReadFile("shaders/vert_depth_packed.spv"));
         auto FragmentShaderCode = ReadFile("shaders/frag.spv");
 
-        VkShaderModule VertexShaderModule = CreateShaderModule(VertexShaderCode);
         VkShaderModule FragmentShaderModule = CreateShaderModule(FragmentShaderCode);
 
         VkPipelineShaderStageCreateInfo VertexShaderStageCreateInfo{};
         VertexShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         VertexShaderStageCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        VertexShaderStageCreateInfo.module = VertexShaderModule;
         VertexShaderStageCreateInfo.pName = "main";
 
         VkPipelineShaderStageCreateInfo FragmentShaderStageCreateInfo{};
@@ -995,15 +5856,33 @@ private:
         DynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(DynamicStates.size());
         DynamicStateCreateInfo.pDynamicStates = DynamicStates.data();
 
-        auto BindingDescription = Vertex3D::GetBindingDescription();
-        auto AttributeDescription = Vertex3D::GetAttributeDescriptions();
-
-        VkPipelineVertexInputStateCreateInfo VertexInputCreateInputInfo{};
-        VertexInputCreateInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        VertexInputCreateInputInfo.vertexBindingDescriptionCount = 1;
-        VertexInputCreateInputInfo.pVertexBindingDescriptions = &BindingDescription;
-        VertexInputCreateInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(AttributeDescription.size());
-        VertexInputCreateInputInfo.pVertexAttributeDescriptions = AttributeDescription.data();
+        auto FloatBindingDescriptions = Vertex3D::GetBindingDescriptions();
+        auto FloatAttributeDescription = Vertex3D::GetAttributeDescriptions();
+        auto PackedBindingDescriptions = PackedVertex3D::GetBindingDescriptions();
+        auto PackedAttributeDescription = PackedVertex3D::GetAttributeDescriptions();
+
+        std::array<VkPipelineVertexInputStateCreateInfo, VERTEX_FORMAT_COUNT> VertexInputCreateInputInfos{};
+        auto& FloatVertexInputInfo = VertexInputCreateInputInfos[static_cast<uint32_t>(VertexFormat::Float)];
+        FloatVertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        FloatVertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(FloatBindingDescriptions.size());
+        FloatVertexInputInfo.pVertexBindingDescriptions = FloatBindingDescriptions.data();
+        FloatVertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(FloatAttributeDescription.size());
+        FloatVertexInputInfo.pVertexAttributeDescriptions = FloatAttributeDescription.data();
+
+        auto& PackedVertexInputInfo = VertexInputCreateInputInfos[static_cast<uint32_t>(VertexFormat::Packed)];
+        PackedVertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        PackedVertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(PackedBindingDescriptions.size());
+        PackedVertexInputInfo.pVertexBindingDescriptions = PackedBindingDescriptions.data();
+        PackedVertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(PackedAttributeDescription.size());
+        PackedVertexInputInfo.pVertexAttributeDescriptions = PackedAttributeDescription.data();
+
+        //The depth only variants see nothing but the position stream
+        std::array<VkPipelineVertexInputStateCreateInfo, VERTEX_FORMAT_COUNT> DepthVertexInputCreateInputInfos = VertexInputCreateInputInfos;
+        for (auto& DepthVertexInputInfo : DepthVertexInputCreateInputInfos)
+        {
+            DepthVertexInputInfo.vertexBindingDescriptionCount = 1;
+            DepthVertexInputInfo.vertexAttributeDescriptionCount = 1;
+        }
 
         VkPipelineInputAssemblyStateCreateInfo InputAssemblyCreateInfo{};
         InputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -1065,7 +5944,8 @@ private:
         DepthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
         DepthStencilStateCreateInfo.depthTestEnable = VK_TRUE;
         DepthStencilStateCreateInfo.depthWriteEnable = VK_TRUE;
-        DepthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+        //Less or equal so the main pass still passes over depth laid down by the prepass
+        DepthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
         DepthStencilStateCreateInfo.depthBoundsTestEnable = VK_FALSE;
         DepthStencilStateCreateInfo.minDepthBounds = 0.0f;
         DepthStencilStateCreateInfo.maxDepthBounds = 1.0f;
@@ -1106,7 +5986,6 @@ private:
         PipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         PipelineCreateInfo.stageCount = 2;
         PipelineCreateInfo.pStages = ShaderStages;
-        PipelineCreateInfo.pVertexInputState = &VertexInputCreateInputInfo;
         PipelineCreateInfo.pInputAssemblyState = &InputAssemblyCreateInfo;
         PipelineCreateInfo.pViewportState = &ViewportStateCreateInfo;
         PipelineCreateInfo.pRasterizationState = &RasterizerStateCreateInfo;
@@ -1122,12 +6001,39 @@ private:
         PipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
         PipelineCreateInfo.basePipelineIndex = -1;
 
-        if (vkCreateGraphicsPipelines(LogicalDevice, VK_NULL_HANDLE, 1, &PipelineCreateInfo, nullptr, &GraphicsPipeline) != VK_SUCCESS)
+        for (uint32_t Format = 0; Format < VERTEX_FORMAT_COUNT; Format++)
+        {
+            ShaderStages[0].module = VertexShaderModules[Format];
+            PipelineCreateInfo.pVertexInputState = &VertexInputCreateInputInfos[Format];
+            if (vkCreateGraphicsPipelines(LogicalDevice, VK_NULL_HANDLE, 1, &PipelineCreateInfo, nullptr, &GraphicsPipelines[Format]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Error creating the graphics pipeline!");
+            }
+        }
+
+        //Depth only variants write no color and run no fragment shader
+        ColorBlendAttachment.colorWriteMask = 0;
+        ColorBlendAttachment.blendEnable = VK_FALSE;
+        DepthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+        PipelineCreateInfo.stageCount = 1;
+        for (uint32_t Format = 0; Format < VERTEX_FORMAT_COUNT; Format++)
         {
-            throw std::runtime_error("Error creating the graphics pipeline!");
+            ShaderStages[0].module = DepthShaderModules[Format];
+            PipelineCreateInfo.pVertexInputState = &DepthVertexInputCreateInputInfos[Format];
+            if (vkCreateGraphicsPipelines(LogicalDevice, VK_NULL_HANDLE, 1, &PipelineCreateInfo, nullptr, &DepthPipelines[Format]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Error creating the depth only pipeline!");
+            }
         }
 
-        vkDestroyShaderModule(LogicalDevice, VertexShaderModule, nullptr);
+        for (auto VertexShaderModule : VertexShaderModules)
+        {
+            vkDestroyShaderModule(LogicalDevice, VertexShaderModule, nullptr);
+        }
+        for (auto DepthShaderModule : DepthShaderModules)
+        {
+            vkDestroyShaderModule(LogicalDevice, DepthShaderModule, nullptr);
+        }
         vkDestroyShaderModule(LogicalDevice, FragmentShaderModule, nullptr);
     }
 
@@ -1263,7 +6169,7 @@ private:
         }
     }
 
-    void RecordCommandBuffer(VkCommandBuffer CommandBuffer, uint32_t ImageIndex)
+    void RecordCommandBuffer(VkCommandBuffer CommandBuffer, uint32_t ImageIndex, bool DrawScene)
     {
         std::array<VkClearValue, 2> ClearColors{};
         ClearColors[0].color = { {0.0f,0.0f,0.0f,1.0f} };
@@ -1309,16 +6215,14 @@ private:
         TransitionImageLayout(CommandBuffer, DepthBufferImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, 0,
             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
 
+        if (DrawScene && IsMeshletCullingActive())
+        {
+            RecordMeshletCulling(CommandBuffer);
+        }
+
         //vkCmdBeginRenderPass(CommandBuffer, &RenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
         vkCmdBeginRendering(CommandBuffer, &RenderingInfo);
 
-        vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GraphicsPipeline);
-
-        VkBuffer VertexBuffers[] = { VertexBuffer };
-        VkDeviceSize Offsets[] = { 0 };
-        vkCmdBindVertexBuffers(CommandBuffer, 0, 1, VertexBuffers, Offsets);
-        vkCmdBindIndexBuffer(CommandBuffer, IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
-
         VkViewport Viewport{};
         Viewport.x = 0.0f;
         Viewport.y = 0.0f;
@@ -1328,15 +6232,21 @@ private:
         Viewport.maxDepth = 1.0f;
         vkCmdSetViewport(CommandBuffer, 0, 1, &Viewport);
 
-        unsigned int VertexCount = 0, IndicesCount = 0;
-        Model.GetCombinedVerticesIndicesCount(VertexCount, IndicesCount);
-
         VkRect2D Scissor{};
         Scissor.offset = { 0,0 };
         Scissor.extent = Extent;
         vkCmdSetScissor(CommandBuffer, 0, 1, &Scissor);
-        vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PipelineLayout, 0, 1, &DescriptorSets[CurrentFrame], 0, nullptr);
-        vkCmdDrawIndexed(CommandBuffer, static_cast<uint32_t>(IndicesCount), 1, 0, 0, 0);
+
+        //Until the scene's uploads land only the clear is recorded
+        if (DrawScene)
+        {
+            vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PipelineLayout, 0, 1, &DescriptorSets[CurrentFrame], 0, nullptr);
+            if (IsDepthPrepassEnabled)
+            {
+                RecordSceneDraws(CommandBuffer, true);
+            }
+            RecordSceneDraws(CommandBuffer, false);
+        }
         vkCmdEndRendering(CommandBuffer);
 
         TransitionImageLayout(CommandBuffer, SwapChainImages[ImageIndex], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
@@ -1348,6 +6258,145 @@ private:
         }
     }
 
+    //Culled indices only exist on the GPU, so the direct submission mode always draws everything
+    bool IsMeshletCullingActive() const
+    {
+        return IsMeshletCullingEnabled && Geometry.MeshletCount > 0 && DrawMode == DrawSubmissionMode::Indirect;
+    }
+
+    //Resets this frame's culled draws to empty and lets the culling shader append the triangles of every visible meshlet to them.
+    //Draw ranges of unselected levels start with zero instances, which also makes the shader skip their meshlets.
+    void RecordMeshletCulling(VkCommandBuffer CommandBuffer)
+    {
+        CopyBuffer(CommandBuffer, CulledDrawTemplateBuffers[CurrentFrame], 0, CulledDrawBuffers[CurrentFrame], 0, sizeof(VkDrawIndexedIndirectCommand) * Geometry.DrawRanges.size());
+
+        VkMemoryBarrier ResetBarrier{};
+        ResetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        ResetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        ResetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &ResetBarrier, 0, nullptr, 0, nullptr);
+
+        //Planes of the frustum pulled back into model space, every mesh is drawn with the same model matrix
+        glm::mat4 ModelView = FrameMatrixes.ViewMatrix * FrameMatrixes.ModelMatrix;
+        glm::mat4 ModelViewProjection = FrameMatrixes.ProjectionMatrix * ModelView;
+        std::array<glm::vec4, 4> Rows;
+        for (int i = 0; i < 4; i++)
+        {
+            Rows[i] = glm::vec4(ModelViewProjection[0][i], ModelViewProjection[1][i], ModelViewProjection[2][i], ModelViewProjection[3][i]);
+        }
+
+        MeshletCullParameters Parameters;
+        Parameters.FrustumPlanes[0] = Rows[3] + Rows[0];
+        Parameters.FrustumPlanes[1] = Rows[3] - Rows[0];
+        Parameters.FrustumPlanes[2] = Rows[3] + Rows[1];
+        Parameters.FrustumPlanes[3] = Rows[3] - Rows[1];
+        Parameters.FrustumPlanes[4] = Rows[2];
+        Parameters.FrustumPlanes[5] = Rows[3] - Rows[2];
+        for (auto& Plane : Parameters.FrustumPlanes)
+        {
+            Plane /= glm::length(glm::vec3(Plane));
+        }
+        Parameters.CameraPosition = glm::vec3(glm::inverse(ModelView)[3]);
+        Parameters.MeshletCount = Geometry.MeshletCount;
+        Parameters.PixelsPerUnit = std::abs(FrameMatrixes.ProjectionMatrix[1][1]) * Extent.height * 0.5f;
+        Parameters.PixelErrorThreshold = LodSettings.PixelErrorThreshold;
+
+        vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, MeshletCullPipeline);
+        vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, MeshletCullPipelineLayout, 0, 1, &MeshletCullDescriptorSets[CurrentFrame], 0, nullptr);
+        vkCmdPushConstants(CommandBuffer, MeshletCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Parameters), &Parameters);
+
+        //One workgroup per meshlet, folded into a second dimension past the guaranteed workgroup count limit
+        const uint32_t MaxGroupCountX = 65535;
+        uint32_t GroupCountX = std::min(Geometry.MeshletCount, MaxGroupCountX);
+        uint32_t GroupCountY = (Geometry.MeshletCount + GroupCountX - 1) / GroupCountX;
+        vkCmdDispatch(CommandBuffer, GroupCountX, GroupCountY, 1);
+
+        VkMemoryBarrier CullBarrier{};
+        CullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        CullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        CullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 1, &CullBarrier, 0, nullptr, 0, nullptr);
+
+        CopyBuffer(CommandBuffer, CulledDrawBuffers[CurrentFrame], 0, CulledDrawReadbackBuffers[CurrentFrame], 0, sizeof(VkDrawIndexedIndirectCommand) * Geometry.DrawRanges.size());
+        VkMemoryBarrier ReadbackBarrier{};
+        ReadbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        ReadbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        ReadbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &ReadbackBarrier, 0, nullptr, 0, nullptr);
+        IsCulledDrawReadbackPending[CurrentFrame] = 1;
+    }
+
+    //Draws every batch, depth only draws bind just the position stream
+    void RecordSceneDraws(VkCommandBuffer CommandBuffer, bool IsDepthOnly)
+    {
+        VertexFormat BoundFormat = VertexFormat::Float;
+        bool IsFormatBound = false;
+        for (uint32_t BatchIndex = 0; BatchIndex < Geometry.DrawBatches.size(); BatchIndex++)
+        {
+            const auto& Batch = Geometry.DrawBatches[BatchIndex];
+            if (Batch.DrawRangeCount == 0) continue;
+
+            //Batches are ordered by format so every pipeline and vertex section is bound once
+            if (!IsFormatBound || Batch.Format != BoundFormat)
+            {
+                uint32_t Format = static_cast<uint32_t>(Batch.Format);
+                vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, IsDepthOnly ? DepthPipelines[Format] : GraphicsPipelines[Format]);
+
+                VkBuffer VertexBuffers[] = { Geometry.VertexBuffer, Geometry.VertexBuffer };
+                const auto& Offsets = Geometry.VertexSectionOffsets[Format];
+                vkCmdBindVertexBuffers(CommandBuffer, 0, IsDepthOnly ? 1 : VERTEX_STREAM_COUNT, VertexBuffers, Offsets.data());
+                BoundFormat = Batch.Format;
+                IsFormatBound = true;
+            }
+
+            //Culled draws take their indices from this frame's culled index buffer, all of it 32-bit and addressed by absolute firstIndex
+            if (IsMeshletCullingActive())
+            {
+                vkCmdBindIndexBuffer(CommandBuffer, CulledIndexBuffers[CurrentFrame], 0, VK_INDEX_TYPE_UINT32);
+                RecordIndirectDraws(CommandBuffer, BatchIndex, CulledDrawBuffers[CurrentFrame]);
+                continue;
+            }
+
+            vkCmdBindIndexBuffer(CommandBuffer, Geometry.IndexBuffer, Batch.IndexOffset, Batch.IndexType);
+            if (DrawMode == DrawSubmissionMode::Indirect)
+            {
+                RecordIndirectDraws(CommandBuffer, BatchIndex, IndirectBuffers[CurrentFrame]);
+            }
+            else
+            {
+                for (uint32_t i = Batch.FirstDrawRange; i < Batch.FirstDrawRange + Batch.DrawRangeCount; i++)
+                {
+                    const auto& DrawRange = Geometry.DrawRanges[i];
+                    if (DrawRange.Lod != SelectedLods[DrawRange.SceneMeshIndex] || DrawRange.InstanceCount == 0) continue;
+                    vkCmdDrawIndexed(CommandBuffer, DrawRange.IndexCount, DrawRange.InstanceCount, DrawRange.FirstIndex, DrawRange.VertexOffset, DrawRange.FirstInstance);
+                }
+            }
+        }
+    }
+
+    //Draws one batch, its commands are stored consecutively and its count is the batch's entry in DrawCountBuffer
+    void RecordIndirectDraws(VkCommandBuffer CommandBuffer, uint32_t BatchIndex, VkBuffer IndirectBuffer)
+    {
+        const auto& Batch = Geometry.DrawBatches[BatchIndex];
+        const uint32_t DrawCount = Batch.DrawRangeCount;
+        const uint32_t Stride = sizeof(VkDrawIndexedIndirectCommand);
+        const VkDeviceSize FirstCommandOffset = static_cast<VkDeviceSize>(Batch.FirstDrawRange) * Stride;
+
+        if (IsDrawIndirectCountSupported && DrawCount <= MaxDrawIndirectCount)
+        {
+            vkCmdDrawIndexedIndirectCount(CommandBuffer, IndirectBuffer, FirstCommandOffset, Geometry.DrawCountBuffer, sizeof(uint32_t) * BatchIndex, DrawCount, Stride);
+            return;
+        }
+
+        //Without multiDrawIndirect every call is limited to a single draw
+        for (uint32_t FirstDraw = 0; FirstDraw < DrawCount; FirstDraw += MaxDrawIndirectCount)
+        {
+            uint32_t CallDrawCount = std::min(MaxDrawIndirectCount, DrawCount - FirstDraw);
+            vkCmdDrawIndexedIndirect(CommandBuffer, IndirectBuffer, FirstCommandOffset + static_cast<VkDeviceSize>(FirstDraw) * Stride, CallDrawCount, Stride);
+        }
+    }
+
     void CreateSyncObjects()
     {
         ImageAvailableSemophores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -1375,6 +6424,14 @@ private:
     void DrawFrame()
     {
         vkWaitForFences(LogicalDevice, 1, &this->InFlightFences[CurrentFrame], VK_TRUE, UINT64_MAX);
+        DestroyRetiredResources(false);
+        if (!IsCulledDrawReadbackPending.empty() && IsCulledDrawReadbackPending[CurrentFrame])
+        {
+            const auto* CulledDraws = static_cast<const VkDrawIndexedIndirectCommand*>(CulledDrawReadbackBuffersMapped[CurrentFrame]);
+            for (size_t i = 0; i < Geometry.DrawRanges.size(); i++) CulledTrianglesDrawn += CulledDraws[i].indexCount / 3;
+            CulledFrameCount++;
+            IsCulledDrawReadbackPending[CurrentFrame] = 0;
+        }
 
         uint32_t ImageIndex;
         VkResult Result = vkAcquireNextImageKHR(LogicalDevice, SwapChain, UINT64_MAX, ImageAvailableSemophores[CurrentFrame], VK_NULL_HANDLE, &ImageIndex);
@@ -1392,15 +6449,60 @@ private:
 
         vkResetCommandBuffer(CommandBuffers[CurrentFrame], 0);
         UpdateUniformBuffer(CurrentFrame);
-        RecordCommandBuffer(CommandBuffers[CurrentFrame], ImageIndex);
+
+        bool IsSceneUploaded = Uploads.IsComplete(SceneUploadTicket);
+        if (IsSceneUploaded)
+        {
+            SelectMeshLods();
+            WriteFrameDrawCommands();
+        }
+
+        auto RecordStart = std::chrono::high_resolution_clock::now();
+        RecordCommandBuffer(CommandBuffers[CurrentFrame], ImageIndex, IsSceneUploaded);
+        if (IsSceneUploaded)
+        {
+            RecordTimeAccumulated += std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - RecordStart).count();
+            if (++RecordedFrameCount == 1000)
+            {
+                std::cout << (DrawMode == DrawSubmissionMode::Indirect ? "Indirect" : "Direct") << " submission of " << Geometry.DrawRanges.size()
+                    << " draws :: " << RecordTimeAccumulated / RecordedFrameCount << "us/frame recording" << std::endl;
+                std::cout << "LOD selection :: " << LodTrianglesDrawn / RecordedFrameCount << " triangles/frame drawn, "
+                    << LodTrianglesSaved / RecordedFrameCount << " triangles/frame saved";
+                if (LodClusterDagMeshesDrawn > 0)
+                {
+                    std::cout << ", not counting " << double(LodClusterDagMeshesDrawn) / RecordedFrameCount << " meshes/frame cut from a cluster DAG";
+                }
+                std::cout << std::endl;
+                if (CulledFrameCount > 0)
+                {
+                    std::cout << "Meshlet culling :: " << CulledTrianglesDrawn / CulledFrameCount << " triangles/frame drawn" << std::endl;
+                }
+                RecordTimeAccumulated = 0.0;
+                RecordedFrameCount = 0;
+                LodTrianglesDrawn = 0;
+                LodTrianglesSaved = 0;
+                LodClusterDagMeshesDrawn = 0;
+                CulledTrianglesDrawn = 0;
+                CulledFrameCount = 0;
+            }
+        }
 
         VkSubmitInfo SubmitInfo{};
         SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore WaitSemaphores[] = { ImageAvailableSemophores[CurrentFrame] };
-        VkPipelineStageFlags WaitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        SubmitInfo.waitSemaphoreCount = 1;
+        //Waiting on the upload timeline is what makes the copied data visible to the graphics queue
+        VkSemaphore WaitSemaphores[] = { ImageAvailableSemophores[CurrentFrame], Uploads.Timeline };
+        VkPipelineStageFlags WaitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT };
+        uint64_t WaitValues[] = { 0, SceneUploadTicket };
+        SubmitInfo.waitSemaphoreCount = IsSceneUploaded ? 2 : 1;
         SubmitInfo.pWaitSemaphores = WaitSemaphores;
+
+        VkTimelineSemaphoreSubmitInfo TimelineSubmitInfo{};
+        TimelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        TimelineSubmitInfo.waitSemaphoreValueCount = SubmitInfo.waitSemaphoreCount;
+        TimelineSubmitInfo.pWaitSemaphoreValues = WaitValues;
+        SubmitInfo.pNext = &TimelineSubmitInfo;
         SubmitInfo.pWaitDstStageMask = WaitStages;
         SubmitInfo.commandBufferCount = 1;
         SubmitInfo.pCommandBuffers = &CommandBuffers[CurrentFrame];
@@ -1413,6 +6515,7 @@ private:
         {
             throw std::runtime_error("Failed to submit draw command buffer!");
         }
+        SubmittedFrameCount++;
 
         VkPresentInfoKHR PresentInfo{};
         PresentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -1457,8 +6560,7 @@ private:
         vkDestroySwapchainKHR(LogicalDevice, SwapChain, nullptr);
 
         vkDestroyImageView(LogicalDevice, DepthBufferImageView, nullptr);
-        vkDestroyImage(LogicalDevice, DepthBufferImage, nullptr);
-        vkFreeMemory(LogicalDevice, DepthBufferImageMemory, nullptr);
+        vmaDestroyImage(Allocator, DepthBufferImage, DepthBufferImageAllocation);
     }
 
     void RecreateSwapChain()
@@ -1470,147 +6572,619 @@ private:
             glfwGetFramebufferSize(window, &width, &height);
             glfwWaitEvents();
         }
-        vkDeviceWaitIdle(this->LogicalDevice);
+        vkDeviceWaitIdle(this->LogicalDevice);
+
+        CleanupSwapChain();
+
+        CreateSwapChain();
+        CreateImageViews();
+        CreateDepthBufferResources();
+        //CreateFramebuffers();
+    }
+
+    void ImportSceneModels()
+    {
+        Models.resize(SceneModelPaths.size());
+        for (size_t i = 0; i < SceneModelPaths.size(); i++)
+        {
+            LoadModel(SceneModelPaths[i], SceneImportSettings, Models[i]);
+        }
+    }
+
+    void CreateGeometryStore()
+    {
+        struct PendingChunk
+        {
+            const Mesh* SourceMesh;
+            const MeshLod* SourceLod;
+            const IndexChunk* Chunk;
+            uint32_t VertexOffset;
+            uint32_t SceneMeshIndex;
+            uint32_t Lod;
+            //Chunks indexing the mesh's vertices directly share one copy of them, only the first one uploads it
+            bool UploadsVertices;
+        };
+
+        //Lay out every chunk of every level first so both buffers can be created at their final size
+        std::vector<std::vector<std::vector<IndexChunk>>> SceneChunks;
+        std::vector<const Mesh*> SceneMeshes;
+        std::vector<VertexFormat> SceneMeshFormats;
+        std::vector<DrawData> SceneMeshDrawData;
+        std::vector<std::vector<glm::mat4>> SceneMeshInstances;
+        Geometry.MeshLods.clear();
+        for (auto& Model : Models)
+        {
+            Model.FirstSceneMesh = static_cast<uint32_t>(SceneMeshes.size());
+            std::vector<std::vector<glm::mat4>> MeshInstances = Model.GetMeshInstances();
+            for (size_t MeshIndex = 0; MeshIndex < Model.Meshes.size(); MeshIndex++)
+            {
+                const auto& Mesh = Model.Meshes[MeshIndex];
+                SceneMeshes.push_back(&Mesh);
+                SceneMeshInstances.push_back(std::move(MeshInstances[MeshIndex]));
+                SceneMeshFormats.push_back(Model.Format);
+                SceneChunks.emplace_back(Mesh.GetDrawLevelCount());
+                for (uint32_t Level = 0; Level < Mesh.GetDrawLevelCount(); Level++)
+                {
+                    const auto& Lod = Mesh.GetDrawLevel(Level);
+                    SplitIndexChunks(Lod.Indices.data(), Lod.Indices.size(), Mesh.Vertices.size(), SceneChunks.back()[Level]);
+                }
+
+                //Float vertices are drawn as they are, chunks of a packed mesh share the quantization of the whole mesh
+                DrawData Data{ glm::mat4(1.0f), glm::vec4(0.0f), glm::vec4(1.0f) };
+                if (Model.Format == VertexFormat::Packed)
+                {
+                    Data = GetPackedDrawData(Mesh.Bounds.Min, Mesh.Bounds.Max);
+                }
+                SceneMeshDrawData.push_back(Data);
+
+                MeshLodInfo LodInfo;
+                for (const auto& Transform : SceneMeshInstances.back())
+                {
+                    LodInfo.InstanceSpheres.push_back(TransformSphere(Transform, Mesh.Bounds.Sphere));
+                    LodInfo.InstanceScales.push_back(LodInfo.InstanceSpheres.back().w / std::max(Mesh.Bounds.Sphere.w, std::numeric_limits<float>::min()));
+                }
+                for (uint32_t Level = 0; Level < Mesh.GetLodCount(); Level++)
+                {
+                    LodInfo.Errors.push_back(Mesh.GetLod(Level).Error);
+                    LodInfo.TriangleCounts.push_back(static_cast<uint32_t>(Mesh.GetLod(Level).Indices.size() / 3));
+                }
+                LodInfo.HasClusterDag = Mesh.GetDrawLevelCount() > Mesh.GetLodCount();
+                Geometry.MeshLods.push_back(std::move(LodInfo));
+            }
+        }
+
+        std::array<std::vector<PendingChunk>, DRAW_BATCH_COUNT> BatchChunks;
+        size_t SourceVertexCount = 0;
+        Geometry.VertexSectionCounts.fill(0);
+        for (uint32_t SceneMeshIndex = 0; SceneMeshIndex < SceneMeshes.size(); SceneMeshIndex++)
+        {
+            const Mesh* SourceMesh = SceneMeshes[SceneMeshIndex];
+            VertexFormat Format = SceneMeshFormats[SceneMeshIndex];
+            auto& SectionVertexCount = Geometry.VertexSectionCounts[static_cast<uint32_t>(Format)];
+            const uint32_t NotUploaded = ~0u;
+            uint32_t SharedVertexOffset = NotUploaded;
+            for (uint32_t Level = 0; Level < SourceMesh->GetDrawLevelCount(); Level++)
+            {
+                for (auto& Chunk : SceneChunks[SceneMeshIndex][Level])
+                {
+                    PendingChunk Pending{ SourceMesh, &SourceMesh->GetDrawLevel(Level), &Chunk, SectionVertexCount, SceneMeshIndex, Level, true };
+                    if (Chunk.SourceVertices.empty() && SharedVertexOffset != NotUploaded)
+                    {
+                        Pending.VertexOffset = SharedVertexOffset;
+                        Pending.UploadsVertices = false;
+                    }
+                    else if (Chunk.SourceVertices.empty())
+                    {
+                        SharedVertexOffset = SectionVertexCount;
+                    }
+                    BatchChunks[GetDrawBatchIndex(Format, Chunk.Is16Bit)].push_back(Pending);
+                    if (Pending.UploadsVertices)
+                    {
+                        SectionVertexCount += static_cast<uint32_t>(Chunk.SourceVertices.empty() ? SourceMesh->Vertices.size() : Chunk.SourceVertices.size());
+                    }
+                }
+            }
+            SourceVertexCount += SourceMesh->Vertices.size();
+        }
+
+        const std::array<std::array<VkDeviceSize, VERTEX_STREAM_COUNT>, VERTEX_FORMAT_COUNT> VertexStrides = { {
+            { sizeof(glm::vec3), sizeof(Vertex3DAttributes) },
+            { sizeof(PackedVertexPosition), sizeof(PackedVertexAttributes) }
+        } };
+        VkDeviceSize VertexBufferSize = 0;
+        VkDeviceSize PositionStreamSize = 0;
+        uint32_t VertexCount = 0;
+        for (uint32_t Format = 0; Format < VERTEX_FORMAT_COUNT; Format++)
+        {
+            for (uint32_t Stream = 0; Stream < VERTEX_STREAM_COUNT; Stream++)
+            {
+                Geometry.VertexSectionOffsets[Format][Stream] = (VertexBufferSize + 15) & ~VkDeviceSize(15);
+                VertexBufferSize = Geometry.VertexSectionOffsets[Format][Stream] + VertexStrides[Format][Stream] * Geometry.VertexSectionCounts[Format];
+            }
+            PositionStreamSize += VertexStrides[Format][VERTEX_STREAM_POSITION] * Geometry.VertexSectionCounts[Format];
+            VertexCount += Geometry.VertexSectionCounts[Format];
+        }
+
+        Geometry.DrawRanges.clear();
+        std::vector<DrawData> InstanceData;
+        std::vector<const Mesh*> DrawRangeMeshes;
+        std::vector<const MeshLod*> DrawRangeLods;
+        std::vector<const IndexChunk*> DrawRangeChunks;
+        VkDeviceSize IndexBufferSize = 0;
+        for (uint32_t BatchIndex = 0; BatchIndex < Geometry.DrawBatches.size(); BatchIndex++)
+        {
+            auto& Batch = Geometry.DrawBatches[BatchIndex];
+            Batch.Format = static_cast<VertexFormat>(BatchIndex / 2);
+            Batch.IndexType = BatchIndex % 2 == 0 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+            VkDeviceSize IndexSize = Batch.IndexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+            Batch.IndexOffset = (IndexBufferSize + 3) & ~VkDeviceSize(3);
+            Batch.FirstDrawRange = static_cast<uint32_t>(Geometry.DrawRanges.size());
+            Batch.DrawRangeCount = static_cast<uint32_t>(BatchChunks[BatchIndex].size());
+            Batch.IndexCount = 0;
+            for (auto& Pending : BatchChunks[BatchIndex])
+            {
+                MeshDrawRange DrawRange;
+                DrawRange.FirstIndex = Batch.IndexCount;
+                DrawRange.VertexOffset = static_cast<int32_t>(Pending.VertexOffset);
+                DrawRange.IndexCount = Pending.Chunk->IndexCount;
+                DrawRange.SceneMeshIndex = Pending.SceneMeshIndex;
+                DrawRange.Lod = Pending.Lod;
+                DrawRange.FirstInstance = static_cast<uint32_t>(InstanceData.size());
+                DrawRange.InstanceCount = static_cast<uint32_t>(SceneMeshInstances[Pending.SceneMeshIndex].size());
+                Geometry.DrawRanges.push_back(DrawRange);
+                for (const auto& Transform : SceneMeshInstances[Pending.SceneMeshIndex])
+                {
+                    InstanceData.push_back(SceneMeshDrawData[Pending.SceneMeshIndex]);
+                    InstanceData.back().Transform = Transform;
+                }
+                DrawRangeMeshes.push_back(Pending.SourceMesh);
+                DrawRangeLods.push_back(Pending.SourceLod);
+                DrawRangeChunks.push_back(Pending.Chunk);
+                Batch.IndexCount += Pending.Chunk->IndexCount;
+            }
+            IndexBufferSize = Batch.IndexOffset + IndexSize * Batch.IndexCount;
+        }
+
+        if (VertexCount == 0 || IndexBufferSize == 0)
+        {
+            throw std::runtime_error("The scene doesn't contain any geometry!");
+        }
+
+        CreateBuffer(VertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Geometry.VertexBuffer, Geometry.VertexBufferAllocation);
+        CreateBuffer(IndexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Geometry.IndexBuffer, Geometry.IndexBufferAllocation);
+        //Meshes no node places leave it empty, it still needs a valid size for its descriptor
+        if (InstanceData.empty()) InstanceData.push_back(SceneMeshDrawData[0]);
+        CreateBuffer(sizeof(DrawData) * InstanceData.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Geometry.DrawDataBuffer, Geometry.DrawDataBufferAllocation);
+
+        std::vector<glm::vec3> Positions;
+        std::vector<Vertex3DAttributes> Attributes;
+        std::vector<PackedVertexPosition> PackedPositions;
+        std::vector<PackedVertexAttributes> PackedAttributes;
+        std::vector<uint16_t> ShortIndices;
+        for (uint32_t BatchIndex = 0; BatchIndex < Geometry.DrawBatches.size(); BatchIndex++)
+        {
+            auto& Batch = Geometry.DrawBatches[BatchIndex];
+            const auto& VertexSectionOffsets = Geometry.VertexSectionOffsets[static_cast<uint32_t>(Batch.Format)];
+            for (uint32_t i = 0; i < Batch.DrawRangeCount; i++)
+            {
+                auto& Pending = BatchChunks[BatchIndex][i];
+                auto& Chunk = *Pending.Chunk;
+                auto& SourceMesh = *Pending.SourceMesh;
+                auto& DrawRange = Geometry.DrawRanges[Batch.FirstDrawRange + i];
+
+                const uint32_t* SourceVertices = Chunk.SourceVertices.empty() ? nullptr : Chunk.SourceVertices.data();
+                size_t ChunkVertexCount = Chunk.SourceVertices.empty() ? SourceMesh.Vertices.size() : Chunk.SourceVertices.size();
+                if (Pending.UploadsVertices && Batch.Format == VertexFormat::Packed)
+                {
+                    PackedPositions.resize(ChunkVertexCount);
+                    PackedAttributes.resize(ChunkVertexCount);
+                    PackVertices(PackedPositions.data(), PackedAttributes.data(), SourceMesh.Vertices.data(), SourceVertices, ChunkVertexCount, SceneMeshDrawData[Pending.SceneMeshIndex]);
+                    UploadToBuffer(Geometry.VertexBuffer, VertexSectionOffsets[VERTEX_STREAM_POSITION] + sizeof(PackedVertexPosition) * Pending.VertexOffset,
+                        PackedPositions.data(), sizeof(PackedVertexPosition) * ChunkVertexCount);
+                    UploadToBuffer(Geometry.VertexBuffer, VertexSectionOffsets[VERTEX_STREAM_ATTRIBUTES] + sizeof(PackedVertexAttributes) * Pending.VertexOffset,
+                        PackedAttributes.data(), sizeof(PackedVertexAttributes) * ChunkVertexCount);
+                }
+                else if (Pending.UploadsVertices)
+                {
+                    Positions.resize(ChunkVertexCount);
+                    Attributes.resize(ChunkVertexCount);
+                    SplitVertices(Positions.data(), Attributes.data(), SourceMesh.Vertices.data(), SourceVertices, ChunkVertexCount);
+                    UploadToBuffer(Geometry.VertexBuffer, VertexSectionOffsets[VERTEX_STREAM_POSITION] + sizeof(glm::vec3) * Pending.VertexOffset,
+                        Positions.data(), sizeof(glm::vec3) * ChunkVertexCount);
+                    UploadToBuffer(Geometry.VertexBuffer, VertexSectionOffsets[VERTEX_STREAM_ATTRIBUTES] + sizeof(Vertex3DAttributes) * Pending.VertexOffset,
+                        Attributes.data(), sizeof(Vertex3DAttributes) * ChunkVertexCount);
+                }
+
+                const uint32_t* ChunkIndices = Pending.SourceLod->Indices.data() + Chunk.FirstIndex;
+                if (Batch.IndexType == VK_INDEX_TYPE_UINT32)
+                {
+                    UploadToBuffer(Geometry.IndexBuffer, Batch.IndexOffset + sizeof(uint32_t) * DrawRange.FirstIndex, ChunkIndices, sizeof(uint32_t) * Chunk.IndexCount);
+                }
+                else if (!Chunk.LocalIndices.empty())
+                {
+                    UploadToBuffer(Geometry.IndexBuffer, Batch.IndexOffset + sizeof(uint16_t) * DrawRange.FirstIndex, Chunk.LocalIndices.data(), sizeof(uint16_t) * Chunk.IndexCount);
+                }
+                else
+                {
+                    ShortIndices.assign(ChunkIndices, ChunkIndices + Chunk.IndexCount);
+                    UploadToBuffer(Geometry.IndexBuffer, Batch.IndexOffset + sizeof(uint16_t) * DrawRange.FirstIndex, ShortIndices.data(), sizeof(uint16_t) * Chunk.IndexCount);
+                }
+            }
+        }
+        UploadToBuffer(Geometry.DrawDataBuffer, 0, InstanceData.data(), sizeof(DrawData) * InstanceData.size());
+        WriteDrawDataDescriptors();
+
+        uint32_t IndexCount16 = 0, IndexCount32 = 0, DrawCount16 = 0, DrawCount32 = 0;
+        for (const auto& Batch : Geometry.DrawBatches)
+        {
+            (Batch.IndexType == VK_INDEX_TYPE_UINT16 ? IndexCount16 : IndexCount32) += Batch.IndexCount;
+            (Batch.IndexType == VK_INDEX_TYPE_UINT16 ? DrawCount16 : DrawCount32) += Batch.DrawRangeCount;
+        }
+        std::cout << "Vertex buffer :: " << VertexBufferSize / 1024 << "KB instead of " << sizeof(Vertex3D) * uint64_t(VertexCount) / 1024 << "KB, "
+            << PositionStreamSize / 1024 << "KB of it read by depth only draws, "
+            << Geometry.VertexSectionCounts[static_cast<uint32_t>(VertexFormat::Packed)] << " packed vertices, "
+            << Geometry.VertexSectionCounts[static_cast<uint32_t>(VertexFormat::Float)] << " float vertices" << std::endl;
+        std::cout << "Index buffer :: " << IndexBufferSize / 1024 << "KB instead of " << sizeof(uint32_t) * (uint64_t(IndexCount16) + IndexCount32) / 1024
+            << "KB, " << DrawCount16 << " 16-bit draws, " << DrawCount32 << " 32-bit draws, "
+            << VertexCount - SourceVertexCount << " vertices duplicated between chunks" << std::endl;
+
+        CreateIndirectDrawBuffers();
+
+        bool HasMeshlets = std::all_of(DrawRangeLods.begin(), DrawRangeLods.end(), [](const MeshLod* Lod) {
+            return Lod->Indices.empty() || !Lod->Meshlets.empty();
+            });
+        if (HasMeshlets)
+        {
+            CreateMeshletCullBuffers(DrawRangeMeshes, DrawRangeLods, DrawRangeChunks);
+        }
+    }
+
+    void CreateMeshletCullBuffers(const std::vector<const Mesh*>& DrawRangeMeshes, const std::vector<const MeshLod*>& DrawRangeLods,
+        const std::vector<const IndexChunk*>& DrawRangeChunks)
+    {
+        std::vector<MeshletCullData> Meshlets;
+        std::vector<uint32_t> MeshletVertices;
+        std::vector<uint32_t> MeshletTriangles;
+        BuildMeshletCullData(DrawRangeMeshes, DrawRangeLods, DrawRangeChunks, Meshlets, MeshletVertices, MeshletTriangles);
+        if (Meshlets.empty()) return;
+
+        //Only one level of a mesh has instances in a frame, so all its levels share one slice of the culled index buffer, as large as
+        //its largest level. The draw ranges of a level, one per index chunk, follow each other inside the slice.
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> LevelIndexCounts;
+        std::vector<uint32_t> MeshSliceOffsets(Geometry.MeshLods.size() + 1, 0);
+        auto& DrawTemplates = Geometry.CulledDrawTemplates;
+        DrawTemplates.clear();
+        DrawTemplates.reserve(Geometry.DrawRanges.size());
+        for (uint32_t i = 0; i < Geometry.DrawRanges.size(); i++)
+        {
+            const auto& DrawRange = Geometry.DrawRanges[i];
+            uint32_t& LevelIndexCount = LevelIndexCounts[{ DrawRange.SceneMeshIndex, DrawRange.Lod }];
+            VkDrawIndexedIndirectCommand DrawTemplate{};
+            DrawTemplate.indexCount = 0;
+            DrawTemplate.instanceCount = DrawRange.InstanceCount;
+            DrawTemplate.firstIndex = LevelIndexCount;
+            DrawTemplate.vertexOffset = DrawRange.VertexOffset;
+            DrawTemplate.firstInstance = DrawRange.FirstInstance;
+            DrawTemplates.push_back(DrawTemplate);
+            LevelIndexCount += DrawRange.IndexCount;
+            MeshSliceOffsets[DrawRange.SceneMeshIndex + 1] = std::max(MeshSliceOffsets[DrawRange.SceneMeshIndex + 1], LevelIndexCount);
+        }
+        for (size_t MeshIndex = 0; MeshIndex < Geometry.MeshLods.size(); MeshIndex++)
+        {
+            MeshSliceOffsets[MeshIndex + 1] += MeshSliceOffsets[MeshIndex];
+        }
+        for (uint32_t i = 0; i < Geometry.DrawRanges.size(); i++)
+        {
+            DrawTemplates[i].firstIndex += MeshSliceOffsets[Geometry.DrawRanges[i].SceneMeshIndex];
+        }
+        Geometry.CulledIndexCount = MeshSliceOffsets.back();
 
-        CleanupSwapChain();
+        CreateBuffer(sizeof(MeshletCullData) * Meshlets.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Geometry.MeshletBuffer, Geometry.MeshletBufferAllocation);
+        CreateBuffer(sizeof(uint32_t) * MeshletVertices.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Geometry.MeshletVertexBuffer, Geometry.MeshletVertexBufferAllocation);
+        CreateBuffer(sizeof(uint32_t) * MeshletTriangles.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Geometry.MeshletTriangleBuffer, Geometry.MeshletTriangleBufferAllocation);
 
-        CreateSwapChain();
-        CreateImageViews();
-        CreateDepthBufferResources();
-        //CreateFramebuffers();
+        UploadToBuffer(Geometry.MeshletBuffer, 0, Meshlets.data(), sizeof(MeshletCullData) * Meshlets.size());
+        UploadToBuffer(Geometry.MeshletVertexBuffer, 0, MeshletVertices.data(), sizeof(uint32_t) * MeshletVertices.size());
+        UploadToBuffer(Geometry.MeshletTriangleBuffer, 0, MeshletTriangles.data(), sizeof(uint32_t) * MeshletTriangles.size());
+        Geometry.MeshletCount = static_cast<uint32_t>(Meshlets.size());
+
+        std::cout << "Meshlet culling :: " << Geometry.MeshletCount << " culled meshlets over " << Geometry.DrawRanges.size() << " draws" << std::endl;
     }
 
-    void ExecuteSingleTimeCommand(std::function<void(VkCommandBuffer& CommandBuffer)> Task, VkCommandPool& Pool, VkQueue& Queue)
+    void CreateIndirectDrawBuffers()
     {
-        VkCommandBufferAllocateInfo CommandBufferAllocateInfo{};
-        CommandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        CommandBufferAllocateInfo.commandPool = Pool;
-        CommandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        CommandBufferAllocateInfo.commandBufferCount = 1;
+        auto& DrawCommands = Geometry.DrawCommands;
+        DrawCommands.clear();
+        DrawCommands.reserve(Geometry.DrawRanges.size());
+        for (uint32_t i = 0; i < Geometry.DrawRanges.size(); i++)
+        {
+            const auto& DrawRange = Geometry.DrawRanges[i];
+            VkDrawIndexedIndirectCommand DrawCommand{};
+            DrawCommand.indexCount = DrawRange.IndexCount;
+            DrawCommand.instanceCount = DrawRange.InstanceCount;
+            DrawCommand.firstIndex = DrawRange.FirstIndex;
+            DrawCommand.vertexOffset = DrawRange.VertexOffset;
+            //Lets the vertex shader find every instance's DrawData through gl_InstanceIndex
+            DrawCommand.firstInstance = DrawRange.FirstInstance;
+            DrawCommands.push_back(DrawCommand);
+        }
+        std::array<uint32_t, DRAW_BATCH_COUNT> DrawCounts;
+        for (uint32_t BatchIndex = 0; BatchIndex < DRAW_BATCH_COUNT; BatchIndex++)
+        {
+            DrawCounts[BatchIndex] = Geometry.DrawBatches[BatchIndex].DrawRangeCount;
+        }
 
-        VkCommandBuffer SingleUseCommandBuffer;
-        vkAllocateCommandBuffers(LogicalDevice, &CommandBufferAllocateInfo, &SingleUseCommandBuffer);
+        CreateBuffer(sizeof(DrawCounts), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Geometry.DrawCountBuffer, Geometry.DrawCountBufferAllocation);
+        UploadToBuffer(Geometry.DrawCountBuffer, 0, DrawCounts.data(), sizeof(DrawCounts));
 
-        VkCommandBufferBeginInfo CommandBufferBeginInfo{};
-        CommandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        CommandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        //The commands change with every frame's LOD selection, so every frame in flight writes its own copy
+        IndirectBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        IndirectBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
+        IndirectBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            CreateBuffer(sizeof(VkDrawIndexedIndirectCommand) * DrawCommands.size(), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, IndirectBuffers[i], IndirectBuffersAllocation[i], &IndirectBuffersMapped[i]);
+        }
+        SelectedLods.assign(Geometry.MeshLods.size(), 0);
+    }
 
-        vkBeginCommandBuffer(SingleUseCommandBuffer, &CommandBufferBeginInfo);
+    void CreateMeshletCulling()
+    {
+        if (Geometry.MeshletCount == 0) return;
 
-        Task(SingleUseCommandBuffer);
+        //Meshlets, meshlet vertices, meshlet triangles, the culled draws, the culled indices and the instances' DrawData
+        const uint32_t BindingCount = 6;
+        std::array<VkDescriptorSetLayoutBinding, BindingCount> Bindings{};
+        for (uint32_t Binding = 0; Binding < BindingCount; Binding++)
+        {
+            Bindings[Binding].binding = Binding;
+            Bindings[Binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            Bindings[Binding].descriptorCount = 1;
+            Bindings[Binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            Bindings[Binding].pImmutableSamplers = nullptr;
+        }
 
-        vkEndCommandBuffer(SingleUseCommandBuffer);
+        VkDescriptorSetLayoutCreateInfo LayoutCreateInfo{};
+        LayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        LayoutCreateInfo.bindingCount = BindingCount;
+        LayoutCreateInfo.pBindings = Bindings.data();
+        if (vkCreateDescriptorSetLayout(LogicalDevice, &LayoutCreateInfo, nullptr, &MeshletCullDescriptorSetLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the meshlet culling descriptor set layout!");
+        }
 
-        VkSubmitInfo CommandBufferSubmitInfo{};
-        CommandBufferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        CommandBufferSubmitInfo.commandBufferCount = 1;
-        CommandBufferSubmitInfo.pCommandBuffers = &SingleUseCommandBuffer;
+        VkPushConstantRange PushConstantRange{};
+        PushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        PushConstantRange.offset = 0;
+        PushConstantRange.size = sizeof(MeshletCullParameters);
 
-        vkQueueSubmit(Queue, 1, &CommandBufferSubmitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(Queue);
+        VkPipelineLayoutCreateInfo PipelineLayoutCreateInfo{};
+        PipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        PipelineLayoutCreateInfo.setLayoutCount = 1;
+        PipelineLayoutCreateInfo.pSetLayouts = &MeshletCullDescriptorSetLayout;
+        PipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        PipelineLayoutCreateInfo.pPushConstantRanges = &PushConstantRange;
+        if (vkCreatePipelineLayout(LogicalDevice, &PipelineLayoutCreateInfo, nullptr, &MeshletCullPipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the meshlet culling pipeline layout!");
+        }
 
-        vkFreeCommandBuffers(LogicalDevice, Pool, 1, &SingleUseCommandBuffer);
-    }
+        CompileGLSL("09_shader_meshlet_cull.comp", "comp_meshlet_cull.spv");
+        VkShaderModule ComputeShaderModule = CreateShaderModule(ReadFile("shaders/comp_meshlet_cull.spv"));
+
+        VkComputePipelineCreateInfo PipelineCreateInfo{};
+        PipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        PipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        PipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        PipelineCreateInfo.stage.module = ComputeShaderModule;
+        PipelineCreateInfo.stage.pName = "main";
+        PipelineCreateInfo.layout = MeshletCullPipelineLayout;
+        if (vkCreateComputePipelines(LogicalDevice, VK_NULL_HANDLE, 1, &PipelineCreateInfo, nullptr, &MeshletCullPipeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the meshlet culling pipeline!");
+        }
+        vkDestroyShaderModule(LogicalDevice, ComputeShaderModule, nullptr);
+
+        CulledDrawTemplateBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        CulledDrawTemplateBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
+        CulledDrawTemplateBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+        CulledDrawBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        CulledDrawBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
+        CulledIndexBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        CulledIndexBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
+        CulledDrawReadbackBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        CulledDrawReadbackBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
+        CulledDrawReadbackBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+        IsCulledDrawReadbackPending.assign(MAX_FRAMES_IN_FLIGHT, 0);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            CreateBuffer(sizeof(VkDrawIndexedIndirectCommand) * Geometry.DrawRanges.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, CulledDrawTemplateBuffers[i], CulledDrawTemplateBuffersAllocation[i],
+                &CulledDrawTemplateBuffersMapped[i]);
+            CreateBuffer(sizeof(VkDrawIndexedIndirectCommand) * Geometry.DrawRanges.size(),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, CulledDrawBuffers[i], CulledDrawBuffersAllocation[i]);
+            CreateBuffer(sizeof(VkDrawIndexedIndirectCommand) * Geometry.DrawRanges.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, CulledDrawReadbackBuffers[i], CulledDrawReadbackBuffersAllocation[i],
+                &CulledDrawReadbackBuffersMapped[i]);
+            CreateBuffer(sizeof(uint32_t) * uint64_t(Geometry.CulledIndexCount), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                CulledIndexBuffers[i], CulledIndexBuffersAllocation[i]);
+        }
 
-    void CreateVertexBuffer()
-    {
-        std::vector<Vertex3D> CombinedVertices;
-        std::vector<unsigned int> CombinedIndices;
-        Model.GetCombinedVerticesIndices(CombinedVertices, CombinedIndices);
-        VkDeviceSize BufferSize = sizeof(Vertex3D) * CombinedVertices.size();
+        VkDescriptorPoolSize PoolSize{};
+        PoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        PoolSize.descriptorCount = static_cast<uint32_t>(BindingCount * MAX_FRAMES_IN_FLIGHT);
 
-        VkBuffer StagingBuffer;
-        VkDeviceMemory StagingBufferMemory;
-        CreateBuffer(BufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, StagingBuffer, StagingBufferMemory);
+        VkDescriptorPoolCreateInfo DescriptorPoolCreateInfo{};
+        DescriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        DescriptorPoolCreateInfo.poolSizeCount = 1;
+        DescriptorPoolCreateInfo.pPoolSizes = &PoolSize;
+        DescriptorPoolCreateInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        if (vkCreateDescriptorPool(LogicalDevice, &DescriptorPoolCreateInfo, nullptr, &MeshletCullDescriptorPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the meshlet culling descriptor pool!");
+        }
 
-        void* Data;
-        vkMapMemory(LogicalDevice, StagingBufferMemory, 0, BufferSize, 0, &Data);
-        memcpy(Data, CombinedVertices.data(), (size_t)BufferSize);
-        vkUnmapMemory(LogicalDevice, StagingBufferMemory);
+        std::vector<VkDescriptorSetLayout> Layouts(MAX_FRAMES_IN_FLIGHT, MeshletCullDescriptorSetLayout);
+        VkDescriptorSetAllocateInfo DescriptorSetAllocateInfo{};
+        DescriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        DescriptorSetAllocateInfo.descriptorPool = MeshletCullDescriptorPool;
+        DescriptorSetAllocateInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        DescriptorSetAllocateInfo.pSetLayouts = Layouts.data();
 
-        CreateBuffer(BufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VertexBuffer, VertexBufferMemory);
-        CopyBuffer(StagingBuffer, VertexBuffer, BufferSize);
+        MeshletCullDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+        if (vkAllocateDescriptorSets(LogicalDevice, &DescriptorSetAllocateInfo, MeshletCullDescriptorSets.data()) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate the meshlet culling descriptor sets!");
+        }
 
-        vkDestroyBuffer(LogicalDevice, StagingBuffer, nullptr);
-        vkFreeMemory(LogicalDevice, StagingBufferMemory, nullptr);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            std::array<VkBuffer, BindingCount> Buffers = { Geometry.MeshletBuffer, Geometry.MeshletVertexBuffer, Geometry.MeshletTriangleBuffer,
+                CulledDrawBuffers[i], CulledIndexBuffers[i], Geometry.DrawDataBuffer };
+            std::array<VkDescriptorBufferInfo, BindingCount> BufferInfos{};
+            std::array<VkWriteDescriptorSet, BindingCount> DescriptorWrites{};
+            for (uint32_t Binding = 0; Binding < BindingCount; Binding++)
+            {
+                BufferInfos[Binding].buffer = Buffers[Binding];
+                BufferInfos[Binding].offset = 0;
+                BufferInfos[Binding].range = VK_WHOLE_SIZE;
+
+                DescriptorWrites[Binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                DescriptorWrites[Binding].dstSet = MeshletCullDescriptorSets[i];
+                DescriptorWrites[Binding].dstBinding = Binding;
+                DescriptorWrites[Binding].dstArrayElement = 0;
+                DescriptorWrites[Binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                DescriptorWrites[Binding].descriptorCount = 1;
+                DescriptorWrites[Binding].pBufferInfo = &BufferInfos[Binding];
+            }
+            vkUpdateDescriptorSets(LogicalDevice, BindingCount, DescriptorWrites.data(), 0, nullptr);
+        }
     }
 
-    void CreateIndexBuffer()
+    void CopyBuffer(VkCommandBuffer& CommandBuffer, VkBuffer SourceBuffer, VkDeviceSize SourceOffset, VkBuffer DestinationBuffer, VkDeviceSize DestinationOffset, VkDeviceSize Size)
     {
-        std::vector<Vertex3D> CombinedVertices;
-        std::vector<uint32_t> CombinedIndices;
-        Model.GetCombinedVerticesIndices(CombinedVertices, CombinedIndices);
-        VkDeviceSize BufferSize = sizeof(uint32_t) * CombinedIndices.size();
+        VkBufferCopy CopyRegion{};
+        CopyRegion.srcOffset = SourceOffset;
+        CopyRegion.dstOffset = DestinationOffset;
+        CopyRegion.size = Size;
+        vkCmdCopyBuffer(CommandBuffer, SourceBuffer, DestinationBuffer, 1, &CopyRegion);
+    }
 
-        VkBuffer StagingBuffer;
-        VkDeviceMemory StagingBufferMemory;
-        CreateBuffer(BufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, StagingBuffer, StagingBufferMemory);
+    void CreateUploadEngine()
+    {
+        Uploads.Create(LogicalDevice, UploadQueue, UploadQueueFamily);
+
+        auto& StagingRing = Uploads.StagingRing;
+        void* MappedData;
+        CreateBuffer(STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            StagingRing.Buffer, StagingRing.Allocation, &MappedData);
+        StagingRing.MappedData = static_cast<char*>(MappedData);
+        StagingRing.Capacity = STAGING_RING_SIZE;
+    }
 
-        void* Data;
-        vkMapMemory(LogicalDevice, StagingBufferMemory, 0, BufferSize, 0, &Data);
-        memcpy(Data, CombinedIndices.data(), (size_t)BufferSize);
-        vkUnmapMemory(LogicalDevice, StagingBufferMemory);
+    UploadTicket UploadToBuffer(VkBuffer DestinationBuffer, VkDeviceSize DestinationOffset, const void* Data, VkDeviceSize Size)
+    {
+        auto& StagingRing = Uploads.StagingRing;
 
-        CreateBuffer(BufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, IndexBuffer, IndexBufferMemory);
-        CopyBuffer(StagingBuffer, IndexBuffer, BufferSize);
+        //Uploads bigger than the ring are streamed through it in chunks
+        VkDeviceSize Uploaded = 0;
+        while (Uploaded < Size)
+        {
+            VkDeviceSize ChunkSize = std::min(Size - Uploaded, StagingRing.Capacity);
+            VkDeviceSize StagingOffset = Uploads.AllocateStaging(ChunkSize, 4);
+            memcpy(StagingRing.MappedData + StagingOffset, static_cast<const char*>(Data) + Uploaded, (size_t)ChunkSize);
 
-        vkDestroyBuffer(LogicalDevice, StagingBuffer, nullptr);
-        vkFreeMemory(LogicalDevice, StagingBufferMemory, nullptr);
+            VkCommandBuffer CommandBuffer = Uploads.GetCommandBuffer();
+            CopyBuffer(CommandBuffer, StagingRing.Buffer, StagingOffset, DestinationBuffer, DestinationOffset + Uploaded, ChunkSize);
+            Uploaded += ChunkSize;
+        }
+        return Uploads.FlushIfFull();
     }
 
-    void CopyBuffer(VkBuffer SourceBuffer, VkBuffer DestinationBuffer, VkDeviceSize Size)
+    void CreateMemoryAllocator()
     {
-        auto CopyCommand = [&](VkCommandBuffer& CommandBuffer) {
-            VkBufferCopy CopyRegion{};
-            CopyRegion.srcOffset = 0;
-            CopyRegion.dstOffset = 0;
-            CopyRegion.size = Size;
-            vkCmdCopyBuffer(CommandBuffer, SourceBuffer, DestinationBuffer, 1, &CopyRegion);
-            };
-        ExecuteSingleTimeCommand(CopyCommand, CommandPool, GraphicsQueue);
+        VmaAllocatorCreateInfo AllocatorCreateInfo{};
+        AllocatorCreateInfo.vulkanApiVersion = VK_API_VERSION_1_3;
+        AllocatorCreateInfo.instance = Instance;
+        AllocatorCreateInfo.physicalDevice = PhysicalDevice;
+        AllocatorCreateInfo.device = LogicalDevice;
+        AllocatorCreateInfo.preferredLargeHeapBlockSize = MEMORY_BLOCK_SIZE;
+
+        if (vmaCreateAllocator(&AllocatorCreateInfo, &Allocator) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the memory allocator!");
+        }
     }
 
-    uint32_t FindMemoryType(uint32_t TypeFilter, VkMemoryPropertyFlags Properties)
+    void PrintMemoryStatistics()
     {
+        VmaTotalStatistics Statistics;
+        vmaCalculateStatistics(Allocator, &Statistics);
+
         VkPhysicalDeviceMemoryProperties MemoryProperties;
         vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &MemoryProperties);
 
-        for (size_t i = 0; i < MemoryProperties.memoryTypeCount; i++)
+        auto PrintStatistics = [](const char* Name, const VmaDetailedStatistics& Detailed) {
+            VkDeviceSize UnusedBytes = Detailed.statistics.blockBytes - Detailed.statistics.allocationBytes;
+            //0 means all the free space is one contiguous range, values close to 1 mean it is scattered in small holes
+            double Fragmentation = UnusedBytes > 0 ? 1.0 - (double)Detailed.unusedRangeSizeMax / (double)UnusedBytes : 0.0;
+            std::cout << Name << " :: Blocks: " << Detailed.statistics.blockCount
+                << " Allocations: " << Detailed.statistics.allocationCount
+                << " Used: " << Detailed.statistics.allocationBytes / 1024 << "KB/" << Detailed.statistics.blockBytes / 1024 << "KB"
+                << " Free ranges: " << Detailed.unusedRangeCount
+                << " Fragmentation: " << Fragmentation << std::endl;
+            };
+
+        std::cout << "Device memory usage: " << std::endl;
+        for (uint32_t i = 0; i < MemoryProperties.memoryTypeCount; i++)
         {
-            if (TypeFilter & (1 << i) && (MemoryProperties.memoryTypes[i].propertyFlags & Properties) == Properties)
-            {
-                return i;
-            }
+            if (Statistics.memoryType[i].statistics.blockCount == 0) continue;
+            PrintStatistics(("\tMemory type " + std::to_string(i)).c_str(), Statistics.memoryType[i]);
         }
+        PrintStatistics("\tTotal", Statistics.total);
     }
 
-    void CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Usage, VkMemoryPropertyFlags Properties, VkBuffer& Buffer, VkDeviceMemory& DeviceMemory)
+    void CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Usage, VkMemoryPropertyFlags Properties, VkBuffer& Buffer, VmaAllocation& Allocation, void** MappedData = nullptr)
     {
         VkBufferCreateInfo BufferCreateInfo{};
         BufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         BufferCreateInfo.size = Size;
         BufferCreateInfo.usage = Usage;
         BufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        if (vkCreateBuffer(LogicalDevice, &BufferCreateInfo, nullptr, &Buffer) != VK_SUCCESS)
+        if ((Usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && SharedQueueFamilies.size() > 1)
         {
-            throw std::runtime_error("Failed to create vertex buffer!");
+            BufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            BufferCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(SharedQueueFamilies.size());
+            BufferCreateInfo.pQueueFamilyIndices = SharedQueueFamilies.data();
         }
 
-        VkMemoryRequirements MemoryRequirements{};
-        vkGetBufferMemoryRequirements(LogicalDevice, Buffer, &MemoryRequirements);
-
-        VkMemoryAllocateInfo AllocationInfo{};
-        AllocationInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        AllocationInfo.allocationSize = MemoryRequirements.size;
-        AllocationInfo.memoryTypeIndex = FindMemoryType(MemoryRequirements.memoryTypeBits, Properties);
+        VmaAllocationCreateInfo AllocationCreateInfo{};
+        AllocationCreateInfo.usage = VMA_MEMORY_USAGE_UNKNOWN;
+        AllocationCreateInfo.requiredFlags = Properties;
+        if (MappedData)
+        {
+            AllocationCreateInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        }
 
-        if (vkAllocateMemory(LogicalDevice, &AllocationInfo, nullptr, &DeviceMemory) != VK_SUCCESS)
+        VmaAllocationInfo AllocationInfo{};
+        if (vmaCreateBuffer(Allocator, &BufferCreateInfo, &AllocationCreateInfo, &Buffer, &Allocation, &AllocationInfo) != VK_SUCCESS)
         {
-            throw std::runtime_error("Failed to allocate memory!");
+            throw std::runtime_error("Failed to create buffer!");
         }
 
-        vkBindBufferMemory(LogicalDevice, Buffer, DeviceMemory, 0);
+        if (MappedData)
+        {
+            *MappedData = AllocationInfo.pMappedData;
+        }
     }
 
     void CreateDescriptorSetLayout()
@@ -1629,10 +7203,17 @@ private:
         TextureLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
         TextureLayoutBinding.pImmutableSamplers = nullptr;
 
-        VkDescriptorSetLayoutBinding Bindings[2] = { UboLayoutBinding,TextureLayoutBinding };
+        VkDescriptorSetLayoutBinding DrawDataLayoutBinding{};
+        DrawDataLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        DrawDataLayoutBinding.binding = 2;
+        DrawDataLayoutBinding.descriptorCount = 1;
+        DrawDataLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        DrawDataLayoutBinding.pImmutableSamplers = nullptr;
+
+        VkDescriptorSetLayoutBinding Bindings[3] = { UboLayoutBinding,TextureLayoutBinding,DrawDataLayoutBinding };
         VkDescriptorSetLayoutCreateInfo LayoutCreateInfo{};
         LayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        LayoutCreateInfo.bindingCount = 2;
+        LayoutCreateInfo.bindingCount = 3;
         LayoutCreateInfo.pBindings = Bindings;
 
         if (vkCreateDescriptorSetLayout(LogicalDevice, &LayoutCreateInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS)
@@ -1646,13 +7227,12 @@ private:
         VkDeviceSize BufferSize = sizeof(Matrixes);
 
         UniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        UniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+        UniformBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
         UniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
-            CreateBuffer(BufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, UniformBuffers[i], UniformBuffersMemory[i]);
-            vkMapMemory(LogicalDevice, UniformBuffersMemory[i], 0, BufferSize, 0, &UniformBuffersMapped[i]);
+            CreateBuffer(BufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, UniformBuffers[i], UniformBuffersAllocation[i], &UniformBuffersMapped[i]);
         }
     }
 
@@ -1688,6 +7268,109 @@ private:
         MatrixUBO.ProjectionMatrix = glm::perspective(glm::radians(45.0f), (float)Extent.width / (float)Extent.height, 0.01f, 1000.0f);
         MatrixUBO.ProjectionMatrix[1][1] *= -1;
         memcpy(UniformBuffersMapped[CurrentImage], &MatrixUBO, sizeof(MatrixUBO));
+        FrameMatrixes = MatrixUBO;
+    }
+
+    //Picks the coarsest level of every mesh whose simplification error stays under the pixel threshold at the mesh's projected size,
+    //then, while the frame is over the triangle budget, coarsens whichever mesh shows the least extra error for it.
+    //Meshes with a cluster DAG draw it whenever meshlet culling runs and selection is on, otherwise they fall back to their discrete levels.
+    void SelectMeshLods()
+    {
+        glm::mat4 ModelView = FrameMatrixes.ViewMatrix * FrameMatrixes.ModelMatrix;
+        float ModelScale = std::max({ glm::length(glm::vec3(FrameMatrixes.ModelMatrix[0])), glm::length(glm::vec3(FrameMatrixes.ModelMatrix[1])),
+            glm::length(glm::vec3(FrameMatrixes.ModelMatrix[2])) });
+        //Pixels covered by one unit of length one unit in front of the camera
+        float PixelsPerUnit = std::abs(FrameMatrixes.ProjectionMatrix[1][1]) * Extent.height * 0.5f;
+
+        //Pixels per mesh space unit of every mesh at its largest placement on screen, infinite when the camera is inside one of its bounding spheres
+        std::vector<float> MeshPixelScales(Geometry.MeshLods.size());
+        uint64_t TriangleCount = 0;
+        uint64_t FullDetailTriangleCount = 0;
+        for (size_t MeshIndex = 0; MeshIndex < Geometry.MeshLods.size(); MeshIndex++)
+        {
+            const auto& LodInfo = Geometry.MeshLods[MeshIndex];
+            uint32_t& Selected = SelectedLods[MeshIndex];
+
+            //The culling pass picks the clusters of a DAG itself, so such meshes stay out of the budget and the triangle counts here.
+            //It only knows one transform per draw, so instanced meshes keep to their discrete levels. With selection off every mesh
+            //draws its full detail level, DAG or not.
+            uint64_t InstanceCount = LodInfo.InstanceSpheres.size();
+            if (IsLodSelectionEnabled && LodInfo.HasClusterDag && InstanceCount == 1 && IsMeshletCullingActive())
+            {
+                Selected = static_cast<uint32_t>(LodInfo.Errors.size());
+                LodClusterDagMeshesDrawn++;
+                continue;
+            }
+            Selected = 0;
+            FullDetailTriangleCount += LodInfo.TriangleCounts[0] * InstanceCount;
+
+            //Every placement draws the same level, the one the closest of them needs
+            MeshPixelScales[MeshIndex] = 0.0f;
+            for (size_t Instance = 0; Instance < InstanceCount; Instance++)
+            {
+                const glm::vec4& Sphere = LodInfo.InstanceSpheres[Instance];
+                glm::vec3 Center = glm::vec3(ModelView * glm::vec4(glm::vec3(Sphere), 1.0f));
+                float Distance = glm::length(Center) - Sphere.w * ModelScale;
+                float PixelScale = Distance > 0.0f ? ModelScale * LodInfo.InstanceScales[Instance] * PixelsPerUnit / Distance : std::numeric_limits<float>::infinity();
+                MeshPixelScales[MeshIndex] = std::max(MeshPixelScales[MeshIndex], PixelScale);
+            }
+            if (IsLodSelectionEnabled)
+            {
+                while (Selected + 1 < LodInfo.Errors.size() && LodInfo.Errors[Selected + 1] * MeshPixelScales[MeshIndex] <= LodSettings.PixelErrorThreshold)
+                {
+                    Selected++;
+                }
+            }
+            TriangleCount += LodInfo.TriangleCounts[Selected] * InstanceCount;
+        }
+
+        while (IsLodSelectionEnabled && LodSettings.TriangleBudget > 0 && TriangleCount > LodSettings.TriangleBudget)
+        {
+            size_t CoarsenedMesh = Geometry.MeshLods.size();
+            float LeastError = std::numeric_limits<float>::infinity();
+            for (size_t MeshIndex = 0; MeshIndex < Geometry.MeshLods.size(); MeshIndex++)
+            {
+                const auto& LodInfo = Geometry.MeshLods[MeshIndex];
+                uint32_t Next = SelectedLods[MeshIndex] + 1;
+                if (Next >= LodInfo.Errors.size() || LodInfo.InstanceSpheres.empty()) continue;
+
+                float Error = LodInfo.Errors[Next] * MeshPixelScales[MeshIndex];
+                if (CoarsenedMesh == Geometry.MeshLods.size() || Error < LeastError)
+                {
+                    CoarsenedMesh = MeshIndex;
+                    LeastError = Error;
+                }
+            }
+            if (CoarsenedMesh == Geometry.MeshLods.size()) break;
+
+            const auto& LodInfo = Geometry.MeshLods[CoarsenedMesh];
+            uint32_t& Selected = SelectedLods[CoarsenedMesh];
+            TriangleCount -= (LodInfo.TriangleCounts[Selected] - LodInfo.TriangleCounts[Selected + 1]) * uint64_t(LodInfo.InstanceSpheres.size());
+            Selected++;
+        }
+
+        LodTrianglesDrawn += TriangleCount;
+        LodTrianglesSaved += FullDetailTriangleCount - TriangleCount;
+    }
+
+    //Copies the draw commands into this frame's buffers with every draw range outside the selected levels at zero instances
+    void WriteFrameDrawCommands()
+    {
+        auto* DrawCommands = static_cast<VkDrawIndexedIndirectCommand*>(IndirectBuffersMapped[CurrentFrame]);
+        for (size_t i = 0; i < Geometry.DrawRanges.size(); i++)
+        {
+            const auto& DrawRange = Geometry.DrawRanges[i];
+            DrawCommands[i] = Geometry.DrawCommands[i];
+            DrawCommands[i].instanceCount = DrawRange.Lod == SelectedLods[DrawRange.SceneMeshIndex] ? DrawRange.InstanceCount : 0;
+        }
+
+        if (Geometry.CulledDrawTemplates.empty()) return;
+        auto* CulledDrawTemplates = static_cast<VkDrawIndexedIndirectCommand*>(CulledDrawTemplateBuffersMapped[CurrentFrame]);
+        for (size_t i = 0; i < Geometry.DrawRanges.size(); i++)
+        {
+            CulledDrawTemplates[i] = Geometry.CulledDrawTemplates[i];
+            CulledDrawTemplates[i].instanceCount = DrawCommands[i].instanceCount;
+        }
     }
 
     void CreateDescriptorPool()
@@ -1700,7 +7383,11 @@ private:
         TexturePoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         TexturePoolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
-        std::vector<VkDescriptorPoolSize> PoolSizes = { UBOPoolSize,TexturePoolSize };
+        VkDescriptorPoolSize DrawDataPoolSize{};
+        DrawDataPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        DrawDataPoolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+
+        std::vector<VkDescriptorPoolSize> PoolSizes = { UBOPoolSize,TexturePoolSize,DrawDataPoolSize };
 
         VkDescriptorPoolCreateInfo DescriptorPoolCreateInfo{};
         DescriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -1738,7 +7425,7 @@ private:
 
             VkDescriptorImageInfo DescriptorCombinedSamplerImageInfo{};
             DescriptorCombinedSamplerImageInfo.sampler = TextureSampler;
-            DescriptorCombinedSamplerImageInfo.imageView = TextureImageView;
+            DescriptorCombinedSamplerImageInfo.imageView = CachedTextures[SceneTextures[0]].Resource.View;
             DescriptorCombinedSamplerImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
             VkWriteDescriptorSet UboDescriptorWrite{};
@@ -1768,56 +7455,432 @@ private:
         }
     }
 
-    void CreateTextureImage(const char* ImageFilePath)
+    //The draw data only exists once the geometry store is laid out, which happens after the descriptor sets are created
+    void WriteDrawDataDescriptors()
     {
-        int Width, Height, ChannelCount;
-        auto Pixels = stbi_load(ImageFilePath, &Width, &Height, &ChannelCount, STBI_rgb_alpha);
-        VkDeviceSize ImageSize = Width * Height * 4;
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            VkDescriptorBufferInfo DescriptorBufferInfo{};
+            DescriptorBufferInfo.buffer = Geometry.DrawDataBuffer;
+            DescriptorBufferInfo.offset = 0;
+            DescriptorBufferInfo.range = VK_WHOLE_SIZE;
+
+            VkWriteDescriptorSet DrawDataDescriptorWrite{};
+            DrawDataDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            DrawDataDescriptorWrite.dstSet = DescriptorSets[i];
+            DrawDataDescriptorWrite.dstBinding = 2;
+            DrawDataDescriptorWrite.dstArrayElement = 0;
+            DrawDataDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            DrawDataDescriptorWrite.descriptorCount = 1;
+            DrawDataDescriptorWrite.pBufferInfo = &DescriptorBufferInfo;
+            DrawDataDescriptorWrite.pImageInfo = nullptr;
+            DrawDataDescriptorWrite.pTexelBufferView = nullptr;
+
+            vkUpdateDescriptorSets(LogicalDevice, 1, &DrawDataDescriptorWrite, 0, nullptr);
+        }
+    }
 
-        if (!Pixels)
+    //Textures are decoded or cooked on worker threads while this thread creates the images and records the uploads of those already done
+    void CreateSceneTextures()
+    {
+        TextureCookTarget Target;
+        Target.BlockCompressed = IsSampledFormatSupported(VK_FORMAT_BC1_RGB_SRGB_BLOCK) && IsSampledFormatSupported(VK_FORMAT_BC3_SRGB_BLOCK);
+        Target.FullMipChain = !IsLinearBlitSupported(VK_FORMAT_R8G8B8A8_SRGB);
+
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        size_t CachedTextureCount = CachedTextures.size() - FreeTextureHandles.size();
+        SceneTextures = AcquireTextures(SceneTexturePaths, Target);
+        std::cout << "Scene textures :: " << SceneTextures.size() << " acquired, " << CachedTextures.size() - FreeTextureHandles.size() - CachedTextureCount
+            << " created in " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count() << "ms" << std::endl;
+
+        CreateTextureSampler();
+    }
+
+    //Returns a handle per path in the same order, each holding a reference. Paths already in the cache only gain a reference and
+    //the rest are loaded together, once per canonical path. A loaded texture whose content is already in the cache isn't created again.
+    //When a texture fails to load every reference taken so far is released again before the exception is passed on.
+    std::vector<TextureHandle> AcquireTextures(const std::vector<const char*>& Paths, const TextureCookTarget& Target)
+    {
+        std::vector<TextureHandle> Handles(Paths.size());
+        std::vector<size_t> LoadIndices(Paths.size(), SIZE_MAX);
+        std::vector<const char*> PathsToLoad;
+        std::vector<std::string> CanonicalPathsToLoad;
+        //How many of the paths lead to each texture that is loaded
+        std::vector<uint32_t> LoadReferenceCounts;
+        for (size_t i = 0; i < Paths.size(); i++)
+        {
+            std::string CanonicalPath = GetCanonicalPath(Paths[i]);
+            auto Cached = TexturesByPath.find(CanonicalPath);
+            if (Cached != TexturesByPath.end())
+            {
+                Handles[i] = Cached->second;
+                CachedTextures[Cached->second].ReferenceCount++;
+                continue;
+            }
+
+            auto Pending = std::find(CanonicalPathsToLoad.begin(), CanonicalPathsToLoad.end(), CanonicalPath);
+            LoadIndices[i] = Pending - CanonicalPathsToLoad.begin();
+            if (Pending == CanonicalPathsToLoad.end())
+            {
+                PathsToLoad.push_back(Paths[i]);
+                CanonicalPathsToLoad.push_back(std::move(CanonicalPath));
+                LoadReferenceCounts.push_back(0);
+            }
+            LoadReferenceCounts[LoadIndices[i]]++;
+        }
+
+        //A texture is referenced as soon as it is in the cache, a failure further on never leaves an entry nothing holds
+        std::vector<TextureHandle> LoadedHandles(PathsToLoad.size(), INVALID_TEXTURE_HANDLE);
+        try
+        {
+            LoadTextures(PathsToLoad, Target, [&](size_t Index, TextureImageData& Texture)
+            {
+                TextureHandle Handle = FindTextureByContent(CanonicalPathsToLoad[Index].c_str(), Texture);
+                if (Handle == INVALID_TEXTURE_HANDLE)
+                {
+                    TextureResource Resource = CreateTextureImage(PathsToLoad[Index], Texture);
+                    Handle = AllocateTextureHandle();
+                    CachedTexture& Cached = CachedTextures[Handle];
+                    Cached.Resource = Resource;
+                    Cached.ContentHash = Texture.ContentHash;
+                    Cached.ContentSize = Texture.ContentSize;
+                    Cached.Format = Texture.Format;
+                    Cached.Width = Texture.Width;
+                    Cached.Height = Texture.Height;
+                    TexturesByContent.emplace(Texture.ContentHash, Handle);
+                }
+                CachedTextures[Handle].Paths.push_back(CanonicalPathsToLoad[Index]);
+                TexturesByPath[CanonicalPathsToLoad[Index]] = Handle;
+                CachedTextures[Handle].ReferenceCount += LoadReferenceCounts[Index];
+                LoadedHandles[Index] = Handle;
+            });
+        }
+        catch (...)
         {
-            throw std::runtime_error("Unable to load the image(" + std::string(ImageFilePath) + ")");
+            for (size_t i = 0; i < Paths.size(); i++)
+            {
+                TextureHandle Handle = LoadIndices[i] == SIZE_MAX ? Handles[i] : LoadedHandles[LoadIndices[i]];
+                if (Handle != INVALID_TEXTURE_HANDLE) ReleaseTexture(Handle);
+            }
+            throw;
         }
 
-        VkBuffer StagingBuffer;
-        VkDeviceMemory StagingBufferMemory;
+        for (size_t i = 0; i < Paths.size(); i++)
+        {
+            if (LoadIndices[i] != SIZE_MAX) Handles[i] = LoadedHandles[LoadIndices[i]];
+        }
+        return Handles;
+    }
 
-        CreateBuffer(ImageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, StagingBuffer, StagingBufferMemory);
+    //The hash only narrows the search. A texture is reused when its format and extent match and its file holds the same bytes, which
+    //maps both files again, but such hits are rare.
+    TextureHandle FindTextureByContent(const char* FilePath, const TextureImageData& Texture)
+    {
+        auto Candidates = TexturesByContent.equal_range(Texture.ContentHash);
+        for (auto Candidate = Candidates.first; Candidate != Candidates.second; ++Candidate)
+        {
+            const CachedTexture& Cached = CachedTextures[Candidate->second];
+            if (Cached.ContentSize == Texture.ContentSize && Cached.Format == Texture.Format && Cached.Width == Texture.Width && Cached.Height == Texture.Height &&
+                HaveSameContents(Cached.Paths[0].c_str(), FilePath))
+            {
+                return Candidate->second;
+            }
+        }
+        return INVALID_TEXTURE_HANDLE;
+    }
 
-        void* Data;
-        vkMapMemory(LogicalDevice, StagingBufferMemory, 0, ImageSize, 0, &Data);
-        memcpy(Data, Pixels, ImageSize);
-        vkUnmapMemory(LogicalDevice, StagingBufferMemory);
+    TextureHandle AllocateTextureHandle()
+    {
+        if (FreeTextureHandles.empty())
+        {
+            CachedTextures.emplace_back();
+            return static_cast<TextureHandle>(CachedTextures.size() - 1);
+        }
+        TextureHandle Handle = FreeTextureHandles.back();
+        FreeTextureHandles.pop_back();
+        return Handle;
+    }
 
-        stbi_image_free(Pixels);
+    void ReleaseTexture(TextureHandle Handle)
+    {
+        CachedTexture& Texture = CachedTextures[Handle];
+        if (Texture.ReferenceCount == 0)
+        {
+            throw std::runtime_error("Released a texture that isn't referenced!");
+        }
+        if (--Texture.ReferenceCount > 0) return;
 
-        CreateImage(Width, Height, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, TextureImage, TextureImageMemory);
+        for (const std::string& Path : Texture.Paths)
+        {
+            TexturesByPath.erase(Path);
+        }
+        auto Candidates = TexturesByContent.equal_range(Texture.ContentHash);
+        TexturesByContent.erase(std::find_if(Candidates.first, Candidates.second, [Handle](const auto& Entry) { return Entry.second == Handle; }));
+        TextureResource Resource = Texture.Resource;
+        RetireResource([this, Resource]()
+        {
+            vkDestroyImageView(LogicalDevice, Resource.View, nullptr);
+            vmaDestroyImage(Allocator, Resource.Image, Resource.Allocation);
+        });
+        Texture = CachedTexture();
+        FreeTextureHandles.push_back(Handle);
+    }
 
-        auto CopyCommand = [&](VkCommandBuffer& CommandBuffer) {
-            TransitionImageLayout(CommandBuffer, TextureImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
-                VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-            CopyBufferToImage(CommandBuffer, StagingBuffer, TextureImage, Width, Height);
-            TransitionImageLayout(CommandBuffer, TextureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-            };
+    //Identical create infos share one sampler, the device's sampler limit only counts the distinct ones
+    VkSampler AcquireSampler(const VkSamplerCreateInfo& CreateInfo)
+    {
+        SamplerKey Key = GetSamplerKey(CreateInfo);
+        uint64_t Hash = HashSamplerKey(Key);
+        auto Candidates = CachedSamplers.equal_range(Hash);
+        for (auto Candidate = Candidates.first; Candidate != Candidates.second; ++Candidate)
+        {
+            if (Candidate->second.Key == Key)
+            {
+                Candidate->second.ReferenceCount++;
+                return Candidate->second.Sampler;
+            }
+        }
+
+        CachedSampler Sampler;
+        Sampler.Key = Key;
+        Sampler.ReferenceCount = 1;
+        if (SamplerCount >= MaxSamplerAllocationCount || vkCreateSampler(LogicalDevice, &CreateInfo, nullptr, &Sampler.Sampler) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create texture sampler!");
+        }
+        SamplerCount++;
+        CachedSamplers.emplace(Hash, Sampler);
+        return Sampler.Sampler;
+    }
+
+    void ReleaseSampler(VkSampler Sampler)
+    {
+        auto Cached = std::find_if(CachedSamplers.begin(), CachedSamplers.end(), [Sampler](const auto& Entry) { return Entry.second.Sampler == Sampler; });
+        if (Cached == CachedSamplers.end())
+        {
+            throw std::runtime_error("Released a sampler that isn't referenced!");
+        }
+        if (--Cached->second.ReferenceCount > 0) return;
 
-        ExecuteSingleTimeCommand(CopyCommand, CommandPool, GraphicsQueue);
+        CachedSamplers.erase(Cached);
+        RetireResource([this, Sampler]()
+        {
+            vkDestroySampler(LogicalDevice, Sampler, nullptr);
+            SamplerCount--;
+        });
+    }
 
-        TextureImageView = CreateImageView(TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
-        CreateTextureSampler();
+    void RetireResource(std::function<void()> Destroy)
+    {
+        RetiredResources.push_back({ SubmittedFrameCount, Uploads.GetPendingTicket(), std::move(Destroy) });
+    }
+
+    //Once the fence of the current frame has been waited on every frame submitted MAX_FRAMES_IN_FLIGHT or more frames ago is done.
+    //Resources are retired in order, so the first one that has to wait holds back the rest.
+    void DestroyRetiredResources(bool IsDeviceIdle)
+    {
+        while (!RetiredResources.empty())
+        {
+            RetiredResource& Resource = RetiredResources.front();
+            if (!IsDeviceIdle && (SubmittedFrameCount < Resource.FrameNumber + MAX_FRAMES_IN_FLIGHT || !Uploads.IsComplete(Resource.Ticket))) break;
+            Resource.Destroy();
+            RetiredResources.pop_front();
+        }
+    }
+
+    TextureResource CreateTextureImage(const char* ImageFilePath, const TextureImageData& Texture)
+    {
+        if (!IsSampledFormatSupported(Texture.Format))
+        {
+            throw std::runtime_error("The device can't sample the format of the texture(" + std::string(ImageFilePath) + ")");
+        }
+
+        //A texture that comes with its base level only gets the rest of its chain blitted on the GPU
+        TextureResource Resource;
+        Resource.MipLevels = GetMipLevelCount(Texture.Width, Texture.Height);
+        bool IsBlitNeeded = Texture.Levels.size() < Resource.MipLevels;
+        if (IsBlitNeeded && !IsLinearBlitSupported(Texture.Format))
+        {
+            Resource.MipLevels = static_cast<uint32_t>(Texture.Levels.size());
+            IsBlitNeeded = false;
+        }
+        CreateImage(Texture.Width, Texture.Height, Resource.MipLevels, VK_IMAGE_TILING_OPTIMAL, Texture.Format,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (IsBlitNeeded ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0),
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, Resource.Image, Resource.Allocation);
+
+        uint32_t BlockExtent, BlockBytes;
+        GetTextureFormatBlock(Texture.Format, BlockExtent, BlockBytes);
+        if (IsBlitNeeded)
+        {
+            //The base level stays a transfer destination, the graphics queue blits the rest of the chain from it
+            UploadToImage(Resource.Image, Texture.Width, Texture.Height, BlockBytes, Texture.Bytes + Texture.Levels[0].Offset, 0, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, BlockExtent);
+            RecordMipGeneration(Resource.Image, Texture.Width, Texture.Height, Resource.MipLevels);
+        }
+        else
+        {
+            for (uint32_t Level = 0; Level < Resource.MipLevels; Level++)
+            {
+                UploadToImage(Resource.Image, GetMipExtent(Texture.Width, Level), GetMipExtent(Texture.Height, Level), BlockBytes, Texture.Bytes + Texture.Levels[Level].Offset,
+                    Level, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, BlockExtent);
+            }
+        }
+
+        Resource.View = CreateImageView(Resource.Image, Texture.Format, VK_IMAGE_ASPECT_COLOR_BIT, Resource.MipLevels);
+        return Resource;
+    }
+
+    //Block compressed formats also need their feature enabled on the device
+    bool IsSampledFormatSupported(VkFormat Format)
+    {
+        uint32_t BlockExtent, BlockBytes;
+        if (!GetTextureFormatBlock(Format, BlockExtent, BlockBytes) || (BlockExtent > 1 && !IsTextureCompressionBCSupported)) return false;
+
+        VkFormatProperties Properties;
+        vkGetPhysicalDeviceFormatProperties(PhysicalDevice, Format, &Properties);
+        const VkFormatFeatureFlags Features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+        return (Properties.optimalTilingFeatures & Features) == Features;
+    }
+
+    //Blitting a chain needs linear filtering and both blit directions in optimal tiling
+    bool IsLinearBlitSupported(VkFormat Format)
+    {
+        VkFormatProperties Properties;
+        vkGetPhysicalDeviceFormatProperties(PhysicalDevice, Format, &Properties);
+        const VkFormatFeatureFlags Features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (Properties.optimalTilingFeatures & Features) == Features;
+    }
+
+    //Fills levels 1 and up of an image whose base level is being uploaded and left as a transfer destination.
+    //Blits need a graphics queue while uploads usually go through a transfer only one, so they are recorded separately.
+    void RecordMipGeneration(VkImage& Image, uint32_t Width, uint32_t Height, uint32_t MipLevels)
+    {
+        if (MipGenerationCommandBuffer == VK_NULL_HANDLE)
+        {
+            VkCommandBufferAllocateInfo CommandBufferAllocateInfo{};
+            CommandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            CommandBufferAllocateInfo.commandPool = CommandPool;
+            CommandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            CommandBufferAllocateInfo.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(LogicalDevice, &CommandBufferAllocateInfo, &MipGenerationCommandBuffer) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to allocate the mip generation command buffer!");
+            }
+
+            VkCommandBufferBeginInfo CommandBufferBeginInfo{};
+            CommandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            CommandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(MipGenerationCommandBuffer, &CommandBufferBeginInfo);
+        }
+
+        VkCommandBuffer& CommandBuffer = MipGenerationCommandBuffer;
+        TransitionImageLayout(CommandBuffer, Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+        if (MipLevels > 1)
+        {
+            TransitionImageLayout(CommandBuffer, Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 1, MipLevels - 1);
+        }
+
+        for (uint32_t Level = 1; Level < MipLevels; Level++)
+        {
+            VkImageBlit Blit{};
+            Blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            Blit.srcSubresource.mipLevel = Level - 1;
+            Blit.srcSubresource.baseArrayLayer = 0;
+            Blit.srcSubresource.layerCount = 1;
+            Blit.srcOffsets[1] = { static_cast<int32_t>(GetMipExtent(Width, Level - 1)), static_cast<int32_t>(GetMipExtent(Height, Level - 1)), 1 };
+            Blit.dstSubresource = Blit.srcSubresource;
+            Blit.dstSubresource.mipLevel = Level;
+            Blit.dstOffsets[1] = { static_cast<int32_t>(GetMipExtent(Width, Level)), static_cast<int32_t>(GetMipExtent(Height, Level)), 1 };
+
+            vkCmdBlitImage(CommandBuffer, Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &Blit, VK_FILTER_LINEAR);
+
+            //The level just written is the source of the next blit
+            TransitionImageLayout(CommandBuffer, Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_IMAGE_ASPECT_COLOR_BIT, Level, 1);
+        }
+
+        TransitionImageLayout(CommandBuffer, Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 0, MipLevels);
+    }
+
+    //Frames are submitted after this on the same queue, the final barriers of the blits order their sampling after them.
+    //The command buffer is left to the command pool, it is only submitted once.
+    void SubmitMipGeneration(UploadTicket BaseLevelsTicket)
+    {
+        if (MipGenerationCommandBuffer == VK_NULL_HANDLE) return;
+
+        vkEndCommandBuffer(MipGenerationCommandBuffer);
+
+        VkTimelineSemaphoreSubmitInfo TimelineSubmitInfo{};
+        TimelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        TimelineSubmitInfo.waitSemaphoreValueCount = 1;
+        TimelineSubmitInfo.pWaitSemaphoreValues = &BaseLevelsTicket;
+
+        VkPipelineStageFlags WaitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        VkSubmitInfo SubmitInfo{};
+        SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        SubmitInfo.pNext = &TimelineSubmitInfo;
+        SubmitInfo.waitSemaphoreCount = 1;
+        SubmitInfo.pWaitSemaphores = &Uploads.Timeline;
+        SubmitInfo.pWaitDstStageMask = &WaitStage;
+        SubmitInfo.commandBufferCount = 1;
+        SubmitInfo.pCommandBuffers = &MipGenerationCommandBuffer;
+
+        if (vkQueueSubmit(GraphicsQueue, 1, &SubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit mip generation commands!");
+        }
+    }
+
+    //Compressed formats pass the bytes of a block of BlockExtent x BlockExtent texels as the texel size
+    UploadTicket UploadToImage(VkImage& DestinationImage, uint32_t Width, uint32_t Height, uint32_t TexelSize, const void* Pixels, uint32_t MipLevel = 0,
+        VkImageLayout FinalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, uint32_t BlockExtent = 1)
+    {
+        auto& StagingRing = Uploads.StagingRing;
+
+        //Rows of blocks are streamed through the staging ring, as many of them as fit at once
+        uint32_t BlockRows = (Height + BlockExtent - 1) / BlockExtent;
+        VkDeviceSize RowPitch = static_cast<VkDeviceSize>((Width + BlockExtent - 1) / BlockExtent) * TexelSize;
+        uint32_t RowsPerChunk = static_cast<uint32_t>(std::min<VkDeviceSize>(BlockRows, StagingRing.Capacity / RowPitch));
+        if (RowsPerChunk == 0)
+        {
+            throw std::runtime_error("Staging ring is too small for a single row of the image!");
+        }
+
+        for (uint32_t Row = 0; Row < BlockRows; Row += RowsPerChunk)
+        {
+            uint32_t RowCount = std::min(RowsPerChunk, BlockRows - Row);
+            VkDeviceSize ChunkSize = RowPitch * RowCount;
+            VkDeviceSize StagingOffset = Uploads.AllocateStaging(ChunkSize, 16);
+            memcpy(StagingRing.MappedData + StagingOffset, static_cast<const char*>(Pixels) + RowPitch * Row, (size_t)ChunkSize);
 
-        vkDestroyBuffer(LogicalDevice, StagingBuffer, nullptr);
-        vkFreeMemory(LogicalDevice, StagingBufferMemory, nullptr);
+            VkCommandBuffer CommandBuffer = Uploads.GetCommandBuffer();
+            if (Row == 0)
+            {
+                TransitionImageLayout(CommandBuffer, DestinationImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_IMAGE_ASPECT_COLOR_BIT, MipLevel, 1);
+            }
+            uint32_t TexelRow = Row * BlockExtent;
+            CopyBufferToImage(CommandBuffer, StagingRing.Buffer, StagingOffset, DestinationImage, Width, std::min(RowCount * BlockExtent, Height - TexelRow), TexelRow, MipLevel);
+            if (Row + RowCount == BlockRows && FinalLayout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+            {
+                //The upload queue may not support the shader stages, the renderer's wait on the timeline makes the writes visible to them
+                TransitionImageLayout(CommandBuffer, DestinationImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, FinalLayout,
+                    VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_IMAGE_ASPECT_COLOR_BIT, MipLevel, 1);
+            }
+        }
+        return Uploads.FlushIfFull();
     }
 
-    void CreateImage(const uint32_t& Width, const uint32_t& Height, VkImageTiling Tiling, VkFormat Format, VkImageUsageFlags Usage, VkMemoryPropertyFlags Properties, VkImage& Image, VkDeviceMemory& ImageMemory)
+    void CreateImage(const uint32_t& Width, const uint32_t& Height, uint32_t MipLevels, VkImageTiling Tiling, VkFormat Format, VkImageUsageFlags Usage, VkMemoryPropertyFlags Properties, VkImage& Image, VmaAllocation& ImageAllocation)
     {
         VkImageCreateInfo ImageCreateInfo{};
         ImageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         ImageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
         ImageCreateInfo.format = Format;
-        ImageCreateInfo.mipLevels = 1;
+        ImageCreateInfo.mipLevels = MipLevels;
         ImageCreateInfo.extent.width = static_cast<uint32_t>(Width);
         ImageCreateInfo.extent.height = static_cast<uint32_t>(Height);
         ImageCreateInfo.extent.depth = 1;
@@ -1826,6 +7889,12 @@ private:
         ImageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         ImageCreateInfo.usage = Usage;
         ImageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if ((Usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) && SharedQueueFamilies.size() > 1)
+        {
+            ImageCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            ImageCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(SharedQueueFamilies.size());
+            ImageCreateInfo.pQueueFamilyIndices = SharedQueueFamilies.data();
+        }
         ImageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         ImageCreateInfo.flags = 0;
 
@@ -1837,21 +7906,27 @@ private:
         VkMemoryRequirements ImageMemoryRequirements;
         vkGetImageMemoryRequirements(LogicalDevice, Image, &ImageMemoryRequirements);
 
-        VkMemoryAllocateInfo ImageMemoryAllocationInfo{};
-        ImageMemoryAllocationInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        ImageMemoryAllocationInfo.allocationSize = ImageMemoryRequirements.size;
-        ImageMemoryAllocationInfo.memoryTypeIndex = FindMemoryType(ImageMemoryRequirements.memoryTypeBits, Properties);
+        VmaAllocationCreateInfo AllocationCreateInfo{};
+        AllocationCreateInfo.usage = VMA_MEMORY_USAGE_UNKNOWN;
+        AllocationCreateInfo.requiredFlags = Properties;
+
+        //Big render targets get their own VkDeviceMemory, everything else is placed inside the shared blocks
+        const VkImageUsageFlags RenderTargetUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        if ((Usage & RenderTargetUsage) && ImageMemoryRequirements.size >= DEDICATED_ALLOCATION_THRESHOLD)
+        {
+            AllocationCreateInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+        }
 
-        if (vkAllocateMemory(LogicalDevice, &ImageMemoryAllocationInfo, nullptr, &ImageMemory) != VK_SUCCESS)
+        if (vmaAllocateMemoryForImage(Allocator, Image, &AllocationCreateInfo, &ImageAllocation, nullptr) != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to allocate memory for the image");
         }
 
-        vkBindImageMemory(LogicalDevice, Image, ImageMemory, 0);
+        vmaBindImageMemory(Allocator, ImageAllocation, Image);
     }
 
     void TransitionImageLayout(VkCommandBuffer& DstCommandBuffer, VkImage& Image, VkImageLayout OldLayout, VkImageLayout NewLayout, VkAccessFlags SrcAccessMask,
-        VkAccessFlags DstAccessMask, VkPipelineStageFlags SrcStage, VkPipelineStageFlags DstStage, VkImageAspectFlags AspectMask)
+        VkAccessFlags DstAccessMask, VkPipelineStageFlags SrcStage, VkPipelineStageFlags DstStage, VkImageAspectFlags AspectMask, uint32_t BaseMipLevel = 0, uint32_t LevelCount = 1)
     {
         VkImageMemoryBarrier ImageBarrier{};
         ImageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -1861,8 +7936,8 @@ private:
         ImageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         ImageBarrier.image = Image;
         ImageBarrier.subresourceRange.aspectMask = AspectMask;
-        ImageBarrier.subresourceRange.baseMipLevel = 0;
-        ImageBarrier.subresourceRange.levelCount = 1;
+        ImageBarrier.subresourceRange.baseMipLevel = BaseMipLevel;
+        ImageBarrier.subresourceRange.levelCount = LevelCount;
         ImageBarrier.subresourceRange.baseArrayLayer = 0;
         ImageBarrier.subresourceRange.layerCount = 1;
         ImageBarrier.srcAccessMask = SrcAccessMask;
@@ -1872,33 +7947,34 @@ private:
             , 0, 0, nullptr, 0, nullptr, 1, &ImageBarrier);
     }
 
-    void CopyBufferToImage(VkCommandBuffer& DstCommandBuffer, VkBuffer& SrcBuffer, VkImage& DstImage, uint32_t Width, uint32_t Height)
+    void CopyBufferToImage(VkCommandBuffer& DstCommandBuffer, VkBuffer& SrcBuffer, VkDeviceSize SrcOffset, VkImage& DstImage, uint32_t Width, uint32_t Height, uint32_t RowOffset = 0,
+        uint32_t MipLevel = 0)
     {
         VkBufferImageCopy CopyRegion{};
-        CopyRegion.bufferOffset = 0;
+        CopyRegion.bufferOffset = SrcOffset;
         CopyRegion.bufferRowLength = 0;
         CopyRegion.bufferImageHeight = 0;
 
         CopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        CopyRegion.imageSubresource.mipLevel = 0;
+        CopyRegion.imageSubresource.mipLevel = MipLevel;
         CopyRegion.imageSubresource.baseArrayLayer = 0;
         CopyRegion.imageSubresource.layerCount = 1;
 
-        CopyRegion.imageOffset = { 0,0,0 };
+        CopyRegion.imageOffset = { 0,static_cast<int32_t>(RowOffset),0 };
         CopyRegion.imageExtent = { Width,Height,1 };
 
         vkCmdCopyBufferToImage(DstCommandBuffer, SrcBuffer, DstImage,
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &CopyRegion);
     }
 
-    VkImageView CreateImageView(VkImage& Image, VkFormat Format, VkImageAspectFlags AspectMask)
+    VkImageView CreateImageView(VkImage& Image, VkFormat Format, VkImageAspectFlags AspectMask, uint32_t MipLevels = 1)
     {
         VkImageViewCreateInfo ImageViewCreateInfo{};
         ImageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         ImageViewCreateInfo.format = Format;
         ImageViewCreateInfo.image = Image;
         ImageViewCreateInfo.subresourceRange.baseMipLevel = 0;
-        ImageViewCreateInfo.subresourceRange.levelCount = 1;
+        ImageViewCreateInfo.subresourceRange.levelCount = MipLevels;
         ImageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
         ImageViewCreateInfo.subresourceRange.layerCount = 1;
         ImageViewCreateInfo.subresourceRange.aspectMask = AspectMask;
@@ -1938,12 +8014,10 @@ private:
         SamplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         SamplerCreateInfo.mipLodBias = 0.0f;
         SamplerCreateInfo.minLod = 0.0f;
-        SamplerCreateInfo.maxLod = 0.0f;
+        //Every view clamps to its own chain, so the same sampler serves textures of any size
+        SamplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
 
-        if (vkCreateSampler(LogicalDevice, &SamplerCreateInfo, nullptr, &TextureSampler) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to create texture sampler!");
-        }
+        TextureSampler = AcquireSampler(SamplerCreateInfo);
     }
 
     VkFormat FindSupportedFormat(const std::vector<VkFormat>& Candidates, VkImageTiling Tiling, VkFormatFeatureFlags Features)
@@ -1970,8 +8044,8 @@ private:
     {
         DepthImageFormat = FindSupportedFormat({ VK_FORMAT_D32_SFLOAT,VK_FORMAT_D32_SFLOAT_S8_UINT,VK_FORMAT_D24_UNORM_S8_UINT },
             VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
-        CreateImage(Extent.width, Extent.height, VK_IMAGE_TILING_OPTIMAL, DepthImageFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DepthBufferImage, DepthBufferImageMemory);
+        CreateImage(Extent.width, Extent.height, 1, VK_IMAGE_TILING_OPTIMAL, DepthImageFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DepthBufferImage, DepthBufferImageAllocation);
         DepthBufferImageView = CreateImageView(DepthBufferImage, DepthImageFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
     }
 };
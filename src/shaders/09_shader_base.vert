@@ -7,6 +7,8 @@ layout(location = 3) in vec3 Normals;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 OutUVcoords;
+//Has to match the depth only shaders bit for bit for the depth prepass
+invariant gl_Position;
 
 layout(binding = 0,set = 0) uniform Matrixes{
     mat4 ModelMatrix;
@@ -14,9 +16,21 @@ layout(binding = 0,set = 0) uniform Matrixes{
     mat4 ProjectionMatrix;
 };
 
+struct DrawData {
+    mat4 Transform;
+    vec4 PositionOffset;
+    vec4 PositionScale;
+};
+
+//Indexed by gl_InstanceIndex, every draw's firstInstance is the first instance of its draw range
+layout(std430, binding = 2, set = 0) readonly buffer DrawDataBuffer{
+    DrawData Draws[];
+};
+
 void main() {
-    vec4 Pos = ProjectionMatrix * ViewMatrix * ModelMatrix * vec4(InPosition.xyz, 1.0);
+    mat4 InstanceModelMatrix = ModelMatrix * Draws[gl_InstanceIndex].Transform;
+    vec4 Pos = ProjectionMatrix * ViewMatrix * InstanceModelMatrix * vec4(InPosition.xyz, 1.0);
     gl_Position = Pos;
-    fragColor = transpose(inverse(mat3(ModelMatrix))) * Normals;
+    fragColor = transpose(inverse(mat3(InstanceModelMatrix))) * Normals;
     OutUVcoords = UVcoords;
 }
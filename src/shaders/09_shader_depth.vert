@@ -0,0 +1,27 @@
+#version 450
+
+layout(location = 0) in vec3 InPosition;
+
+invariant gl_Position;
+
+layout(binding = 0,set = 0) uniform Matrixes{
+    mat4 ModelMatrix;
+    mat4 ViewMatrix;
+    mat4 ProjectionMatrix;
+};
+
+struct DrawData {
+    mat4 Transform;
+    vec4 PositionOffset;
+    vec4 PositionScale;
+};
+
+//Indexed by gl_InstanceIndex, every draw's firstInstance is the first instance of its draw range
+layout(std430, binding = 2, set = 0) readonly buffer DrawDataBuffer{
+    DrawData Draws[];
+};
+
+void main() {
+    vec4 Pos = ProjectionMatrix * ViewMatrix * (ModelMatrix * Draws[gl_InstanceIndex].Transform) * vec4(InPosition.xyz, 1.0);
+    gl_Position = Pos;
+}
@@ -0,0 +1,29 @@
+#version 450
+
+layout(location = 0) in vec4 InPosition;
+
+invariant gl_Position;
+
+layout(binding = 0,set = 0) uniform Matrixes{
+    mat4 ModelMatrix;
+    mat4 ViewMatrix;
+    mat4 ProjectionMatrix;
+};
+
+struct DrawData {
+    mat4 Transform;
+    vec4 PositionOffset;
+    vec4 PositionScale;
+};
+
+//Indexed by gl_InstanceIndex, every draw's firstInstance is the first instance of its draw range
+layout(std430, binding = 2, set = 0) readonly buffer DrawDataBuffer{
+    DrawData Draws[];
+};
+
+void main() {
+    DrawData Draw = Draws[gl_InstanceIndex];
+    vec3 Position = Draw.PositionOffset.xyz + InPosition.xyz * Draw.PositionScale.xyz;
+    vec4 Pos = ProjectionMatrix * ViewMatrix * (ModelMatrix * Draw.Transform) * vec4(Position, 1.0);
+    gl_Position = Pos;
+}
@@ -0,0 +1,45 @@
+#version 450
+
+layout(location = 0) in vec4 InPosition;
+layout(location = 1) in vec2 UVcoords;
+layout(location = 2) in vec2 OctahedralNormal;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 OutUVcoords;
+//Has to match the depth only shaders bit for bit for the depth prepass
+invariant gl_Position;
+
+layout(binding = 0,set = 0) uniform Matrixes{
+    mat4 ModelMatrix;
+    mat4 ViewMatrix;
+    mat4 ProjectionMatrix;
+};
+
+struct DrawData {
+    mat4 Transform;
+    vec4 PositionOffset;
+    vec4 PositionScale;
+};
+
+//Indexed by gl_InstanceIndex, every draw's firstInstance is the first instance of its draw range
+layout(std430, binding = 2, set = 0) readonly buffer DrawDataBuffer{
+    DrawData Draws[];
+};
+
+vec3 DecodeOctahedral(vec2 Encoded) {
+    vec3 Normal = vec3(Encoded.xy, 1.0 - abs(Encoded.x) - abs(Encoded.y));
+    float Fold = max(-Normal.z, 0.0);
+    Normal.x += Normal.x >= 0.0 ? -Fold : Fold;
+    Normal.y += Normal.y >= 0.0 ? -Fold : Fold;
+    return normalize(Normal);
+}
+
+void main() {
+    DrawData Draw = Draws[gl_InstanceIndex];
+    vec3 Position = Draw.PositionOffset.xyz + InPosition.xyz * Draw.PositionScale.xyz;
+    mat4 InstanceModelMatrix = ModelMatrix * Draw.Transform;
+    vec4 Pos = ProjectionMatrix * ViewMatrix * InstanceModelMatrix * vec4(Position, 1.0);
+    gl_Position = Pos;
+    fragColor = transpose(inverse(mat3(InstanceModelMatrix))) * DecodeOctahedral(OctahedralNormal);
+    OutUVcoords = UVcoords;
+}